@@ -0,0 +1,46 @@
+#! /bin/bash
+
+# compares worklist strategies (option --worklist) of bcheck on R itself
+# to be run from R source directory, after the bitcode files have been created (e.g. using build_r.sh)
+#
+# for each strategy, reports the number of traversed states and the time
+# bcheck spent on R.bin.bc; the outputs are kept in ./src/main/R.bin.bcheck.<strategy>
+
+# strategies to compare can be specified as arguments
+
+if [ X"$*" == X ] ; then
+  STRATEGIES="dfs bfs rpo loops-last"
+else
+  STRATEGIES="$*"
+fi
+
+if [ ! -r $RCHK/scripts/config.inc ] ; then
+  echo "Please set RCHK variables (scripts/config.inc)" >&2
+  exit 2
+fi
+
+if [ ! -x $RCHK/src/bcheck ] ; then
+  echo "Please set RCHK variables (scripts/config.inc) and RCHK installation - cannot find tool bcheck." >&2
+  exit 2
+fi
+
+. $RCHK/scripts/common.inc
+
+if ! check_config ; then
+  exit 2
+fi
+
+if [ ! -r ./src/main/R.bin.bc ] ; then
+  echo "This script has to be run from the root of R source directory with bitcode files (e.g. src/main/R.bin.bc)." >&2
+  exit 2
+fi
+
+printf "%-12s %15s %10s\n" strategy states seconds
+for S in $STRATEGIES ; do
+  FOUT=./src/main/R.bin.bcheck.$S
+  START=`date +%s.%N`
+  $RCHK/src/bcheck --worklist $S ./src/main/R.bin.bc >$FOUT 2>&1
+  END=`date +%s.%N`
+  STATES=`sed -n -e 's/^Analyzed .* functions, traversed \([0-9]*\) states.*/\1/p' $FOUT`
+  printf "%-12s %15s %10.1f\n" $S "$STATES" `echo "$END - $START" | bc`
+done
@@ -25,7 +25,7 @@ if [ ! -r $RCHK/scripts/config.inc ] ; then
   exit 2
 fi
 
-for T in $TOOLS ; do
+for T in $TOOLS rchk ; do
   if [ ! -x $RCHK/src/$T ] ; then
     echo "Please set RCHK variables (scripts/config.inc) and RCHK installation - cannot find tool $T." >&2
     exit 2
@@ -96,12 +96,21 @@ find $PKGDIR -name "*.so" | while read SOF ; do
 done
 
 # run the tools
+#   the tools are run together (rchk driver) on each package bitcode file
+#   with some outdated tool output, all such files in one batch, so that
+#   the R bitcode file is read only once and each package is linked once
 
-for T in $TOOLS ; do
-  find $PKGDIR -name "*.bc" | grep -v '\.o\.bc' | while read F ; do
+BATCH=`mktemp`
+find $PKGDIR -name "*.bc" | grep -v '\.o\.bc' | while read F ; do
+  for T in $TOOLS ; do
     FOUT=`echo $F | sed -e 's/\.bc$/.'$T'/g'`
     if [ ! -r $FOUT ] || [ $F -nt $FOUT ] || [ $RBC -nt $FOUT ] ; then
-      $RCHK/src/$T $RBC $F >$FOUT 2>&1
+      echo $F
+      break
     fi
   done
-done
+done >$BATCH
+if [ -s $BATCH ] ; then
+  $RCHK/src/rchk --tools `echo $TOOLS | tr ' ' ','` --snapshot $RBC.snapshot --batch $BATCH $RBC
+fi
+rm -f $BATCH
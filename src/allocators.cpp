@@ -2,6 +2,7 @@
 #include "allocators.h"
 #include "exceptions.h"
 #include "patterns.h"
+#include "snapshot.h"
 
 using namespace llvm;
 
@@ -26,14 +27,36 @@ Function *getGCFunction(Module *m) {
   return gcf;
 }
 
-unsigned getGCFunctionIndex(FunctionsInfoMapTy& functionsMap, Module *m) {
+FunctionsBitsTy findGCCallers(FunctionsInfoMapTy& functionsMap, Module *m) {
 
   auto fsearch = functionsMap.find(getGCFunction(m));
   if (fsearch == functionsMap.end()) {
     errs() << "Cannot find function info in callgraph for function " << gcFunction << ", internal error?\n";
     exit(1);
   }
-  return fsearch->second.index;
+  return findCallersOf(functionsMap, {&fsearch->second});
+}
+
+// functions in the callgraph that may (transitively) call any of the given
+// functions, adds those and the given functions to result
+static void addCallersOf(FunctionsInfoMapTy& functionsMap, const FunctionsSetTy& targets, FunctionsSetTy& result) {
+
+  std::vector<const FunctionInfo*> targetInfos;
+  for(FunctionsSetTy::const_iterator fi = targets.begin(), fe = targets.end(); fi != fe; ++fi) {
+    auto fsearch = functionsMap.find(*fi);
+    if (fsearch != functionsMap.end()) {
+      targetInfos.push_back(&fsearch->second);
+    }
+    result.insert(*fi);
+  }
+  FunctionsBitsTy callers = findCallersOf(functionsMap, targetInfos);
+  
+  for(FunctionsInfoMapTy::iterator fi = functionsMap.begin(), fe = functionsMap.end(); fi != fe; ++fi) {
+    Function *f = const_cast<Function *>(fi->second.function);
+    if (f && callers[fi->second.index]) {
+      result.insert(f);
+    }
+  }
 }
 
 // Possible allocators are (all) functions that may be returning a pointer
@@ -187,14 +210,26 @@ void findPossibleAllocators(Module *m, FunctionsSetTy& possibleAllocators) {
   FunctionsSetTy onlyFunctions;
   CallEdgesMapTy onlyEdges;
   Function* gcFunction = getGCFunction(m);
+  const BaseSnapshotTy* snapshot = getBaseSnapshot();
+  
+  // base functions are known from the snapshot, only the package functions
+  // wrapping them need to be found
+  FunctionsSetTy targets;
+  targets.insert(gcFunction);
+  if (snapshot) {
+    addFunctionsByName(m, snapshot->possibleAllocators, targets);
+  }
 
-  onlyFunctions.insert(gcFunction);
+  onlyFunctions.insert(targets.begin(), targets.end());
   for(Module::iterator fi = m->begin(), fe = m->end(); fi != fe; ++fi) {
     Function *f = &*fi;
 
     if (isKnownNonAllocator(f) || isAssertedNonAllocating(f)) {
       continue;
     }
+    if (snapshot && snapshot->isBaseFunction(f)) {
+      continue;
+    }
     FunctionsSetTy wrappedAllocators;
     getWrappedAllocators(f, wrappedAllocators, gcFunction);
     if (!wrappedAllocators.empty()) {
@@ -204,27 +239,16 @@ void findPossibleAllocators(Module *m, FunctionsSetTy& possibleAllocators) {
   }
   
   FunctionsInfoMapTy functionsMap;
-  buildCGClosure(m, functionsMap, true /* ignore error paths */, &onlyFunctions, &onlyEdges, gcFunction /* assume external functions allocate */);
+  buildCG(m, functionsMap, true /* ignore error paths */, &onlyFunctions, &onlyEdges, gcFunction /* assume external functions allocate */);
 
   for(CallEdgesMapTy::iterator cei = onlyEdges.begin(), cee = onlyEdges.end(); cei != cee; ++cei) {
     delete cei->second;
   }
   
-  unsigned gcFunctionIndex = getGCFunctionIndex(functionsMap, m);
-
-  for(FunctionsInfoMapTy::iterator fi = functionsMap.begin(), fe = functionsMap.end(); fi != fe; ++fi) {
-    Function *f = const_cast<Function *>(fi->second.function);
-    if (!f) continue;
-
-    if ((fi->second.callsFunctionMap)[gcFunctionIndex]) {
-      possibleAllocators.insert(f);
-    }
-  }
-  
-  possibleAllocators.insert(gcFunction);
+  addCallersOf(functionsMap, targets, possibleAllocators);
 }
 
-bool isAllocatingFunction(Function *fun, FunctionsInfoMapTy& functionsMap, unsigned gcFunctionIndex) {
+bool isAllocatingFunction(Function *fun, FunctionsInfoMapTy& functionsMap, const FunctionsBitsTy& gcCallers) {
   if (!fun || isAssertedNonAllocating(fun)) {
     return false;
   }
@@ -235,32 +259,59 @@ bool isAllocatingFunction(Function *fun, FunctionsInfoMapTy& functionsMap, unsig
   }
   FunctionInfo& finfo = fsearch->second;
 
-  return (finfo.callsFunctionMap)[gcFunctionIndex];
+  return gcCallers[finfo.index];
 }
 
 void findAllocatingFunctions(Module *m, FunctionsSetTy& allocatingFunctions) {
 
   FunctionsSetTy onlyFunctions;
+  Function* gcFunction = getGCFunction(m);
+  const BaseSnapshotTy* snapshot = getBaseSnapshot();
+  
+  FunctionsSetTy targets;
+  targets.insert(gcFunction);
+  if (snapshot) {
+    addFunctionsByName(m, snapshot->allocatingFunctions, targets);
+  }
 
   for(Module::iterator fi = m->begin(), fe = m->end(); fi != fe; ++fi) {
     Function *f = &*fi;
-    if (!isAssertedNonAllocating(f)) {
-      onlyFunctions.insert(f);
+    if (isAssertedNonAllocating(f)) {
+      continue;
     }
+    if (snapshot && snapshot->isBaseFunction(f) && targets.find(f) == targets.end()) {
+      continue; // known not to allocate
+    }
+    onlyFunctions.insert(f);
   }
   
   FunctionsInfoMapTy functionsMap;
-  buildCGClosure(m, functionsMap, true /* ignore error paths */, &onlyFunctions, NULL, getGCFunction(m) /* assume external functions allocate */);
+  buildCG(m, functionsMap, true /* ignore error paths */, &onlyFunctions, NULL, gcFunction /* assume external functions allocate */);
+
+  addCallersOf(functionsMap, targets, allocatingFunctions);
+}
 
-  unsigned gcFunctionIndex = getGCFunctionIndex(functionsMap, m);
+ArgExpKind classifyArgumentExpression(Value *arg, FunctionsInfoMapTy& functionsMap, const FunctionsBitsTy& gcCallers, FunctionsSetTy& possibleAllocators) {
 
-  for(FunctionsInfoMapTy::iterator fi = functionsMap.begin(), fe = functionsMap.end(); fi != fe; ++fi) {
-    Function *f = const_cast<Function *>(fi->second.function);
-    if (!f) continue;
+  if (!CallInst::classof(arg)) {
+    // argument does not come (immediatelly) from a call
+    return AK_NOALLOC;
+  }
 
-    if ((fi->second.callsFunctionMap)[gcFunctionIndex]) {
-      allocatingFunctions.insert(f);
-    }
+  CallInst *cinst = cast<CallInst>(arg);
+  Function *fun = cinst->getCalledFunction();
+  if (!fun) {
+    return AK_NOALLOC;
+  }
+
+  if (!isAllocatingFunction(fun, functionsMap, gcCallers)) {
+    // argument does not come from a call to an allocating function
+    return AK_NOALLOC;
+  }
+
+  if (possibleAllocators.find(fun) != possibleAllocators.end()) {
+    // the argument allocates and returns a fresh object
+    return AK_FRESH;
   }
-  allocatingFunctions.insert(getGCFunction(m));
+  return AK_ALLOCATING;
 }
@@ -19,12 +19,15 @@ using namespace llvm;
 const std::string gcFunction = "R_gc_internal";
 
 Function *getGCFunction(Module *m);
-unsigned getGCFunctionIndex(FunctionsInfoMapTy& functionsMap, Module *m);
+
+// functions in the callgraph that may (transitively) call the GC function,
+// by FunctionInfo index
+FunctionsBitsTy findGCCallers(FunctionsInfoMapTy& functionsMap, Module *m);
 
 bool mayBeAllocator(Function& f);
 void findPossibleAllocators(Module *m, FunctionsSetTy& possibleAllocators);
 
-bool isAllocatingFunction(Function *fun, FunctionsInfoMapTy& functionsMap, unsigned gcFunctionIndex);
+bool isAllocatingFunction(Function *fun, FunctionsInfoMapTy& functionsMap, const FunctionsBitsTy& gcCallers);
 void findAllocatingFunctions(Module *m, FunctionsSetTy& allocatingFunctions);
 
 void findPossiblyReturnedVariables(Function *f, VarsSetTy& possiblyReturned);
@@ -32,4 +35,13 @@ void getWrappedAllocators(Function *f, FunctionsSetTy& wrappedAllocators, Functi
 
 bool isKnownNonAllocator(Function *f);
 
+enum ArgExpKind {
+  AK_NOALLOC = 0,  // no allocation
+  AK_ALLOCATING,   // allocation, but not returning a fresh object
+  AK_FRESH         // allocation and possibly returning a fresh object
+};
+
+// kind of allocation done by the expression giving a call argument, for a callgraph from buildCG
+ArgExpKind classifyArgumentExpression(Value *arg, FunctionsInfoMapTy& functionsMap, const FunctionsBitsTy& gcCallers, FunctionsSetTy& possibleAllocators);
+
 #endif
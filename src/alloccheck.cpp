@@ -19,16 +19,11 @@
 #include "callocators.h"
 #include "errors.h"
 #include "cprotect.h"
+#include "tools.h"
 
 using namespace llvm;
 
-int main(int argc, char* argv[])
-{
-  LLVMContext context;
-
-  FunctionsOrderedSetTy functionsOfInterestSet;
-  FunctionsVectorTy functionsOfInterestVector;
-  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);
+static int runAlloccheck(Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
   CalledModuleTy *cm = CalledModuleTy::create(m);
 
   FunctionsSetTy *possibleAllocators = cm->getPossibleAllocators();
@@ -207,5 +202,14 @@ int main(int argc, char* argv[])
   }
 
   CalledModuleTy::release(cm);  
-  delete m;
+  return 0;
+}
+
+const ToolTy alloccheckTool = { "alloccheck", NULL, runAlloccheck };
+
+#ifndef RCHK_DRIVER
+int main(int argc, char* argv[])
+{
+  return runTool(argc, argv, alloccheckTool);
 }
+#endif
@@ -0,0 +1,159 @@
+
+#include "analyses.h"
+#include "allocators.h"
+#include "errors.h"
+
+using namespace llvm;
+
+ModuleAnalysesTy::ModuleAnalysesTy(Module *m): m(m), errorFunctions(NULL), errorBlocks(), callGraph(NULL),
+  functionsInfo(NULL), gcCallers(), gcCallersFound(false), possibleAllocators(NULL), allocatingFunctions(NULL), symbolsMap(NULL), dominatorTrees(), functionVars() {}
+
+ModuleAnalysesTy::~ModuleAnalysesTy() {
+
+  delete errorFunctions;
+  delete callGraph;
+  delete functionsInfo;
+  delete possibleAllocators;
+  delete allocatingFunctions;
+  delete symbolsMap;
+  for(auto di = dominatorTrees.begin(), de = dominatorTrees.end(); di != de; ++di) {
+    delete di->second;
+  }
+  for(auto vi = functionVars.begin(), ve = functionVars.end(); vi != ve; ++vi) {
+    delete vi->second;
+  }
+}
+
+// the lock is recursive, computing one result may need another one (e.g.
+// allocators need the call graph, which needs error blocks)
+
+FunctionsSetTy* ModuleAnalysesTy::getErrorFunctions() {
+
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  if (!errorFunctions) {
+    errorFunctions = new FunctionsSetTy();
+    findErrorFunctions(m, *errorFunctions);
+  }
+  return errorFunctions;
+}
+
+const BasicBlocksSetTy& ModuleAnalysesTy::getErrorBasicBlocks(Function *fun) {
+
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  auto bsearch = errorBlocks.find(fun);
+  if (bsearch != errorBlocks.end()) {
+    return bsearch->second;
+  }
+  FunctionsSetTy *efuns = getErrorFunctions();
+  BasicBlocksSetTy& blocks = errorBlocks[fun];
+  findErrorBasicBlocks(fun, efuns, blocks);
+  return blocks;
+}
+
+CallGraph* ModuleAnalysesTy::getCallGraph() {
+
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  if (!callGraph) {
+    callGraph = new CallGraph(*m);
+  }
+  return callGraph;
+}
+
+FunctionsInfoMapTy* ModuleAnalysesTy::getFunctionsInfo() {
+
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  if (!functionsInfo) {
+    functionsInfo = new FunctionsInfoMapTy();
+    buildCG(m, *functionsInfo, true /* ignore error paths */);
+  }
+  return functionsInfo;
+}
+
+const FunctionsBitsTy& ModuleAnalysesTy::getGCCallers() {
+
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  if (!gcCallersFound) {
+    gcCallers = findGCCallers(*getFunctionsInfo(), m);
+    gcCallersFound = true;
+  }
+  return gcCallers;
+}
+
+FunctionsSetTy* ModuleAnalysesTy::getPossibleAllocators() {
+
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  if (!possibleAllocators) {
+    possibleAllocators = new FunctionsSetTy();
+    findPossibleAllocators(m, *possibleAllocators);
+  }
+  return possibleAllocators;
+}
+
+FunctionsSetTy* ModuleAnalysesTy::getAllocatingFunctions() {
+
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  if (!allocatingFunctions) {
+    allocatingFunctions = new FunctionsSetTy();
+    findAllocatingFunctions(m, *allocatingFunctions);
+  }
+  return allocatingFunctions;
+}
+
+SymbolsMapTy* ModuleAnalysesTy::getSymbolsMap() {
+
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  if (!symbolsMap) {
+    symbolsMap = new SymbolsMapTy();
+    findSymbols(m, symbolsMap);
+  }
+  return symbolsMap;
+}
+
+DominatorTree* ModuleAnalysesTy::getDominatorTree(Function *fun) {
+
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  auto dsearch = dominatorTrees.find(fun);
+  if (dsearch != dominatorTrees.end()) {
+    return dsearch->second;
+  }
+  DominatorTree *dt = new DominatorTree(*fun);
+  dominatorTrees.insert({fun, dt});
+  return dt;
+}
+
+FunctionVarsTy* ModuleAnalysesTy::getFunctionVars(Function *fun, const GlobalsTy* g, bool forChecking) {
+
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  FunctionVarsTy*& vars = functionVars[fun];
+  if (!vars) {
+    vars = new FunctionVarsTy(fun, g);
+  }
+  if (forChecking) {
+    vars->classifyForChecking(g);
+  }
+  return vars;
+}
+
+static std::unordered_map<Module*, ModuleAnalysesTy*> modulesAnalyses;
+
+ModuleAnalysesTy* getModuleAnalyses(Module *m) {
+
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  auto msearch = modulesAnalyses.find(m);
+  if (msearch != modulesAnalyses.end()) {
+    return msearch->second;
+  }
+  ModuleAnalysesTy *ma = new ModuleAnalysesTy(m);
+  modulesAnalyses.insert({m, ma});
+  return ma;
+}
+
+void forgetModuleAnalyses(Module *m) {
+
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  auto msearch = modulesAnalyses.find(m);
+  if (msearch != modulesAnalyses.end()) {
+    delete msearch->second;
+    modulesAnalyses.erase(msearch);
+  }
+}
@@ -0,0 +1,64 @@
+#ifndef RCHK_ANALYSES_H
+#define RCHK_ANALYSES_H
+
+#include "common.h"
+#include "cgclosure.h"
+#include "localvars.h"
+#include "symbols.h"
+
+#include <unordered_map>
+
+#include <llvm/Analysis/CallGraph.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+
+using namespace llvm;
+
+// results of module-wide analyses, shared by the tools and their subsystems
+//
+//   each result is computed on first use and then kept, so that e.g. the
+//   error functions are not found again by each call graph construction;
+//   the results are owned by the module analyses and are valid until
+//   forgetModuleAnalyses, which has to be called when the module changes
+//   (e.g. when another module is linked into it) or before it is deleted
+//
+//   the getters can be called from multiple checking threads
+
+class ModuleAnalysesTy {
+
+  Module *m;
+  FunctionsSetTy *errorFunctions;
+  std::unordered_map<Function*, BasicBlocksSetTy> errorBlocks;
+  CallGraph *callGraph;
+  FunctionsInfoMapTy *functionsInfo;
+  FunctionsBitsTy gcCallers;
+  bool gcCallersFound;
+  FunctionsSetTy *possibleAllocators;
+  FunctionsSetTy *allocatingFunctions;
+  SymbolsMapTy *symbolsMap;
+  std::unordered_map<Function*, DominatorTree*> dominatorTrees;
+  std::unordered_map<Function*, FunctionVarsTy*> functionVars;
+
+  public:
+    ModuleAnalysesTy(Module *m);
+    ~ModuleAnalysesTy();
+
+    Module* getModule() const { return m; }
+
+    FunctionsSetTy* getErrorFunctions();
+    const BasicBlocksSetTy& getErrorBasicBlocks(Function *fun);
+    CallGraph* getCallGraph();
+    FunctionsInfoMapTy* getFunctionsInfo(); // from buildCG, ignoring error paths
+    const FunctionsBitsTy& getGCCallers(); // for getFunctionsInfo
+    FunctionsSetTy* getPossibleAllocators();
+    FunctionsSetTy* getAllocatingFunctions();
+    SymbolsMapTy* getSymbolsMap();
+    DominatorTree* getDominatorTree(Function *fun);
+    FunctionVarsTy* getFunctionVars(Function *fun, const GlobalsTy* g, bool forChecking = false); // for bcheck, forChecking also classifies the checking kinds
+};
+
+ModuleAnalysesTy* getModuleAnalyses(Module *m);
+void forgetModuleAnalyses(Module *m);
+
+#endif
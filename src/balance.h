@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "linemsg.h"
+#include "localvars.h"
 #include "state.h"
 
 #include <map>
@@ -49,13 +50,12 @@ struct StateWithBalanceTy : virtual public StateBaseTy {
   void dump(bool verbose);  
 };
 
-bool isProtectionStackTopSaveVariable(AllocaInst* var, GlobalVariable* ppStackTopVariable, VarBoolCacheTy& cache);
-bool isProtectionCounterVariable(AllocaInst* var, Function* unprotectFunction, VarBoolCacheTy& cache);
+bool isProtectionStackTopSaveVariable(AllocaInst* var, GlobalVariable* ppStackTopVariable);
+bool isProtectionCounterVariable(AllocaInst* var, Function* unprotectFunction);
 
-void handleBalanceForNonTerminator(Instruction *in, BalanceStateTy& b, GlobalsTy& g, VarBoolCacheTy& counterVarsCache, VarBoolCacheTy& saveVarsCache,
-    LineMessenger& msg, unsigned& refinableInfos);
+void handleBalanceForNonTerminator(Instruction *in, BalanceStateTy& b, GlobalsTy& g, const FunctionVarsTy& vars, LineMessenger& msg, unsigned& refinableInfos);
 
-bool handleBalanceForTerminator(TerminatorInst* t, StateWithBalanceTy& s, GlobalsTy& g, VarBoolCacheTy& counterVarsCache,
+bool handleBalanceForTerminator(TerminatorInst* t, StateWithBalanceTy& s, GlobalsTy& g, const FunctionVarsTy& vars,
     LineMessenger& msg, unsigned& refinableInfos);
 
 #endif
@@ -12,34 +12,51 @@
   The tool also looks for hints that there is an unprotected pointer while
   calling into a function that may allocate.  This is approximate only and
   has a lot of false alarms.
+
+  With option "-j N", functions are checked concurrently by N threads. The
+  output is buffered per function and printed in the same order as when
+  checking sequentially.
 */
 
 #include "common.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
-#include <stack>
+#include <thread>
 #include <unordered_set>
 #include <unordered_map>
 
 #include <llvm/IR/Module.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Constants.h>
+#include <llvm/IR/InstIterator.h>
 #include <llvm/Analysis/CFG.h>
 #include <llvm/Analysis/CallGraph.h>
 
+#include <llvm/Support/Format.h>
 #include <llvm/Support/raw_ostream.h>
 
-#include "errors.h"
+#include "analyses.h"
 #include "callocators.h"
 #include "allocators.h"
 #include "balance.h"
+#include "budget.h"
+#include "worklist.h"
 #include "freshvars.h"
 #include "guards.h"
 #include "linemsg.h"
 #include "symbols.h"
 #include "exceptions.h"
 #include "liveness.h"
+#include "region.h"
+#include "table.h"
+#include "tools.h"
 
 using namespace llvm;
 
@@ -87,82 +104,165 @@ const bool EXCLUDE_PROTECTION_FUNCTIONS = true;
 
 // -------------------------------- basic block state -----------------------------------
 
-const int MAX_STATES = BCHECK_MAX_STATES;        // maximum number of states visited per function
+const unsigned long DEFAULT_MAX_STATES = 3000000; // maximum number of states visited per function, unless --max-states is given
 
-unsigned int nComparedEqual = 0;
-unsigned int nComparedDifferent = 0;
+thread_local unsigned long nComparedEqual = 0;
+thread_local unsigned long nComparedDifferent = 0;
 
-struct BcheckStateTy : public StateWithGuardsTy, StateWithFreshVarsTy, StateWithBalanceTy {
+// stored states are hash-consed: each component of a state is interned in a
+// per-thread table and a state in the done set is a tuple of pointers to the
+// interned components, so comparing stored states is cheap and components
+// common to many states are stored only once
+
+struct BalanceStateTy_hash { // balance state has a fixed size, so it is hashed directly
+  size_t operator()(const BalanceStateTy& b) const {
+    size_t res = 0;
+    hash_combine(res, b.depth);
+    hash_combine(res, b.count);
+    hash_combine(res, b.savedDepth);
+    // not including topSaveVar
+    hash_combine(res, (int) b.countState);
+    return res;
+  }
+};
+
+struct BalanceStateTy_equal {
+  bool operator() (const BalanceStateTy& lhs, const BalanceStateTy& rhs) const {
+    return lhs.depth == rhs.depth && lhs.savedDepth == rhs.savedDepth && lhs.count == rhs.count &&
+      lhs.countState == rhs.countState && lhs.counterVar == rhs.counterVar && lhs.confused == rhs.confused &&
+      lhs.topSaveVar == rhs.topSaveVar;
+  }
+};
+
+// the hashes of guards, fresh variables, the protect stack and conditional
+// messages are maintained incrementally by the handlers (see hashed.h)
+
+template <class T>
+struct IncrementalHash {
+  size_t operator()(const T& t) const {
+    return t.hash();
+  }
+};
+
+struct ComponentTablesTy {
+  InterningTable<BalanceStateTy, BalanceStateTy_hash, BalanceStateTy_equal> balance;
+  InterningTable<IntGuardsTy, IncrementalHash<IntGuardsTy>> intGuards;
+  InterningTable<SEXPGuardsTy, IncrementalHash<SEXPGuardsTy>> sexpGuards;
+  InterningTable<FreshVarsVarsTy, IncrementalHash<FreshVarsVarsTy>> freshVars;
+  InterningTable<VarsVectorTy, IncrementalHash<VarsVectorTy>> pstack;
+  InterningTable<ConditionalMessagesTy, IncrementalHash<ConditionalMessagesTy>> condMsgs;
   
+  void clear() {
+    balance.clear();
+    intGuards.clear();
+    sexpGuards.clear();
+    freshVars.clear();
+    pstack.clear();
+    condMsgs.clear();
+  }
+};
+
+thread_local ComponentTablesTy componentTables;
+
+struct BcheckPackedStateTy {
+  BasicBlock *bb;
+  const BalanceStateTy *balance;
+  const IntGuardsTy *intGuards;
+  const SEXPGuardsTy *sexpGuards;
+  const FreshVarsVarsTy *freshVars;
+  const VarsVectorTy *pstack;
+  const ConditionalMessagesTy *condMsgs;
+  bool freshVarsConfused;
   size_t hashcode;
+  mutable bool visited; // all successors have been added (not part of the state)
+  
+  BcheckPackedStateTy(BasicBlock *bb, const BalanceStateTy *balance, const IntGuardsTy *intGuards, const SEXPGuardsTy *sexpGuards,
+    const FreshVarsVarsTy *freshVars, const VarsVectorTy *pstack, const ConditionalMessagesTy *condMsgs, bool freshVarsConfused):
+    
+    bb(bb), balance(balance), intGuards(intGuards), sexpGuards(sexpGuards), freshVars(freshVars), pstack(pstack), condMsgs(condMsgs),
+    freshVarsConfused(freshVarsConfused), hashcode(0), visited(false) {
+    
+    size_t res = 0;
+    hash_combine(res, bb);
+    hash_combine(res, (const void *) balance);
+    hash_combine(res, (const void *) intGuards);
+    hash_combine(res, (const void *) sexpGuards);
+    hash_combine(res, (const void *) freshVars);
+    hash_combine(res, (const void *) pstack);
+    hash_combine(res, (const void *) condMsgs);
+    hash_combine(res, freshVarsConfused);
+    hashcode = res;
+  }
+};
+
+struct BcheckPackedStateTy_hash {
+  size_t operator()(const BcheckPackedStateTy& t) const {
+    return t.hashcode;
+  }
+};
+
+struct BcheckPackedStateTy_equal {
+  bool operator() (const BcheckPackedStateTy& lhs, const BcheckPackedStateTy& rhs) const {
+
+    if (!FULL_COMPARISON) {
+      return lhs.hashcode == rhs.hashcode;
+      // we could just return true, because the map will not call this for objects with
+      // different hashcodes
+    }
+    
+    // components are interned
+    bool res = lhs.bb == rhs.bb && lhs.balance == rhs.balance && lhs.intGuards == rhs.intGuards && lhs.sexpGuards == rhs.sexpGuards &&
+      lhs.freshVars == rhs.freshVars && lhs.pstack == rhs.pstack && lhs.condMsgs == rhs.condMsgs && lhs.freshVarsConfused == rhs.freshVarsConfused;
+    
+    // counted always, the counts are part of telemetry
+    if (res) {
+      nComparedEqual++;
+    } else {
+      nComparedDifferent++;
+    }
+    return res;
+  }
+};
+
+struct BcheckStateTy : public StateWithGuardsTy, StateWithFreshVarsTy, StateWithBalanceTy {
+  
+  const BcheckPackedStateTy *packed; // this state in the done set, set by add()
   public:
     BcheckStateTy(BasicBlock *bb):
-      StateBaseTy(bb), StateWithGuardsTy(bb), StateWithFreshVarsTy(bb), StateWithBalanceTy(bb), hashcode(0) {};
+      StateBaseTy(bb), StateWithGuardsTy(bb), StateWithFreshVarsTy(bb), StateWithBalanceTy(bb), packed(NULL) {};
 
     BcheckStateTy(BasicBlock *bb, BalanceStateTy& balance, IntGuardsTy& intGuards, SEXPGuardsTy& sexpGuards, FreshVarsTy& freshVars):
-      StateBaseTy(bb), StateWithGuardsTy(bb, intGuards, sexpGuards), StateWithFreshVarsTy(bb, freshVars), StateWithBalanceTy(bb, balance), hashcode(0) {};
+      StateBaseTy(bb), StateWithGuardsTy(bb, intGuards, sexpGuards), StateWithFreshVarsTy(bb, freshVars), StateWithBalanceTy(bb, balance), packed(NULL) {};
       
     virtual BcheckStateTy* clone(BasicBlock *newBB) {
       return new BcheckStateTy(newBB, balance, intGuards, sexpGuards, freshVars);
     }
     
     virtual bool add();
-    void hash() {
-      size_t res = 0;
-      hash_combine(res, bb);
-      hash_combine(res, balance.depth);
-      hash_combine(res, balance.count);
-      hash_combine(res, balance.savedDepth);
-      // not including topSaveVar
-      hash_combine(res, (int) balance.countState);
-      hash_combine(res, intGuards.size());
-      for(IntGuardsTy::const_iterator gi = intGuards.begin(), ge = intGuards.end(); gi != ge; ++gi) {
-        AllocaInst* var = gi->first;
-        IntGuardState s = gi->second;
-        hash_combine(res, (void *)var);
-        hash_combine(res, (char) s);
-      } // ordered map
-
-      hash_combine(res, sexpGuards.size());
-      for(SEXPGuardsTy::const_iterator gi = sexpGuards.begin(), ge = sexpGuards.end(); gi != ge; ++gi) {
-        AllocaInst* var = gi->first;
-        const SEXPGuardTy& g = gi->second;
-        hash_combine(res, (void *) var);
-        hash_combine(res, (char) g.state);
-        if (g.state == SGS_SYMBOL) {
-          hash_combine(res, g.symbolName);
-        }
-      } // ordered map
-
-      hash_combine(res, freshVars.vars.size());
-      for(FreshVarsVarsTy::iterator fi = freshVars.vars.begin(), fe = freshVars.vars.end(); fi != fe; ++fi) {
-        AllocaInst* in = fi->first;
-        int pcount = fi->second;
-        hash_combine(res, (void *) in);
-        hash_combine(res, pcount);
-      } // ordered set
-
-      hash_combine(res, freshVars.condMsgs.size());
-      for(ConditionalMessagesTy::iterator mi = freshVars.condMsgs.begin(), me = freshVars.condMsgs.end(); mi != me; ++mi) {
-        DelayedLineMessenger& msg = mi->second;
-        hash_combine(res, msg.size());
-        
-        for(LineInfoPtrSetTy::const_iterator li = msg.delayedLineBuffer.begin(), le = msg.delayedLineBuffer.end(); li != le; ++li) {
-          const LineInfoTy* l = *li;
-          hash_combine(res, (const void *) l);
-        }
-      } // condMsgs is unordered
-
-      hash_combine(res, freshVars.pstack.size());
-      for(VarsVectorTy::iterator vi = freshVars.pstack.begin(), ve = freshVars.pstack.end(); vi != ve; ++vi) {
-        AllocaInst* var = *vi;
-        hash_combine(res, (void *) var);
-      }
-      hashcode = res;
+    
+    // states are allocated in the region of the checking thread (see clearStates)
+    static void* operator new(size_t size) { return StateRegion::current->allocate(size); }
+    static void operator delete(void *p, size_t size) { StateRegion::current->deallocate(p, size); }
+    
+    BcheckPackedStateTy pack() const {
+      ComponentTablesTy& t = componentTables;
+      return BcheckPackedStateTy(bb, t.balance.intern(balance), t.intGuards.intern(intGuards), t.sexpGuards.intern(sexpGuards),
+        t.freshVars.intern(freshVars.vars), t.pstack.intern(freshVars.pstack), t.condMsgs.intern(freshVars.condMsgs), freshVars.confused);
+    }
+    
+    static BcheckStateTy* unpack(const BcheckPackedStateTy& ps) {
+      BalanceStateTy balance = *ps.balance;
+      IntGuardsTy intGuards = *ps.intGuards;
+      SEXPGuardsTy sexpGuards = *ps.sexpGuards;
+      FreshVarsTy freshVars = { *ps.freshVars, *ps.pstack, *ps.condMsgs, ps.freshVarsConfused };
+      BcheckStateTy* s = new BcheckStateTy(ps.bb, balance, intGuards, sexpGuards, freshVars);
+      s->packed = &ps;
+      return s;
     }
 
     void dump() {
       outs().flush();
+      size_t hashcode = packed ? packed->hashcode : 0;
       errs() << " vvvvvvvvvvvvvvvvvvvvvv  " << std::to_string(hashcode) << " vvvvvvvvvvvvvvvvvvvvvv";
       StateBaseTy::dump(VERBOSE_DUMP);
       StateWithGuardsTy::dump(VERBOSE_DUMP);
@@ -174,59 +274,39 @@ struct BcheckStateTy : public StateWithGuardsTy, StateWithFreshVarsTy, StateWith
 
 };
 
-// the hashcode is cached at the time of first hashing
-//   (and indeed is not copied)
+// the done set has packed states, the worklist has full states (not yet visited)
+//   a full state is deleted once visited
 
-struct BcheckStateTy_hash {
-  size_t operator()(const BcheckStateTy* t) const {
-    return t->hashcode;
-  }
-};
+typedef StateWorkList<BcheckStateTy*> WorkListTy;
+typedef std::unordered_set<BcheckPackedStateTy, BcheckPackedStateTy_hash, BcheckPackedStateTy_equal> DoneSetTy;
 
-struct BcheckStateTy_equal {
-  bool operator() (const BcheckStateTy* lhs, const BcheckStateTy* rhs) const {
+// ------------- helper functions --------------
 
-    if (!FULL_COMPARISON) {
-      return lhs->hashcode == rhs->hashcode;
-      // we could just return true, because the map will not call this for objects with
-      // different hashcodes
-    }
-    
-    bool res;
-    if (lhs == rhs) {
-      res = true;
-    } else {
-      res = lhs->bb == rhs->bb && 
-      lhs->balance.depth == rhs->balance.depth && lhs->balance.savedDepth == rhs->balance.savedDepth && lhs->balance.count == rhs->balance.count &&
-      lhs->balance.countState == rhs->balance.countState && lhs->balance.counterVar == rhs->balance.counterVar && lhs->balance.confused == rhs->balance.confused &&
-      lhs->balance.topSaveVar == rhs->balance.topSaveVar &&
-      lhs->intGuards == rhs->intGuards && lhs->sexpGuards == rhs->sexpGuards &&
-      lhs->freshVars.vars == rhs->freshVars.vars && lhs->freshVars.condMsgs == rhs->freshVars.condMsgs && lhs->freshVars.pstack == rhs->freshVars.pstack
-         && lhs->freshVars.confused == rhs->freshVars.confused;
-    }
-    
-    if (PROGRESS_MARKS) {
-      if (res) {
-        nComparedEqual++;
-      } else {
-        nComparedDifferent++;
-      }
-    }
-    return res;
-  }
-};
+// each checking thread has its own states
+thread_local DoneSetTy doneSet;
+thread_local WorkListTy workList;   
+thread_local StateRegion stateRegion; // memory for the states, including their maps and sets
 
-typedef std::stack<BcheckStateTy*> WorkListTy;
-typedef std::unordered_set<BcheckStateTy*, BcheckStateTy_hash, BcheckStateTy_equal> DoneSetTy;
+// when checking may be restarted with more precise guards, the successors
+// of visited states and the messages emitted while visiting them are
+// recorded, so that states not affected by the guards can be kept for the
+// restart (see FunctionChecker::keepGuardIndependentStates)
 
-// ------------- helper functions --------------
+typedef std::pair<const BcheckPackedStateTy*, const BcheckPackedStateTy*> StateEdgeTy;
+typedef std::pair<const BcheckPackedStateTy*, const LineInfoTy*> StateMessageTy;
 
-DoneSetTy doneSet;
-WorkListTy workList;   
+thread_local bool recordingVisits = false;
+thread_local const BcheckPackedStateTy* visitedState = NULL; // the state being visited
+thread_local std::vector<StateEdgeTy> stateEdges;
+thread_local std::vector<StateMessageTy> stateMessages;
+thread_local std::vector<const LineInfoTy*> emittedMessages; // while visiting the current state
 
 bool BcheckStateTy::add() {
-  hash(); // precompute hashcode
-  auto sinsert = doneSet.insert(this);
+  auto sinsert = doneSet.insert(pack());
+  packed = &*sinsert.first;
+  if (recordingVisits && visitedState) {
+    stateEdges.push_back({visitedState, packed});
+  }
   if (sinsert.second) {
     workList.push(this);
     if (DUMP_STATES && (DUMP_STATES_FUNCTION.empty() || DUMP_STATES_FUNCTION == bb->getParent()->getName())) {
@@ -241,19 +321,73 @@ bool BcheckStateTy::add() {
   }
 }
 
-unsigned long totalStates = 0;
+thread_local unsigned long totalStates = 0;
+
+StateBudgetTy stateBudget(DEFAULT_MAX_STATES, 0); // per checking thread, set in main
+
+// statistics of checking a single function
+//   with option --telemetry FILE, they are written to FILE as one JSON
+//   object per line, in the order of the functions
+
+struct FunctionStatsTy {
+  unsigned long states;     // traversed
+  unsigned restarts;        // with more precise guards
+  unsigned long peakStates; // maximum size of the done set
+  unsigned long comparedEqual;
+  unsigned long comparedDifferent;
+  double seconds;           // elapsed
+  const char* exceeded;     // "states" or "time" when the budget was exceeded, otherwise NULL
+
+  FunctionStatsTy(): states(0), restarts(0), peakStates(0), comparedEqual(0), comparedDifferent(0), seconds(0), exceeded(NULL) {};
+};
+
+static std::string jsonString(const std::string& str) {
+  std::string res = "\"";
+  for(std::string::const_iterator ci = str.begin(), ce = str.end(); ci != ce; ++ci) {
+    unsigned char c = *ci;
+    if (c == '"' || c == '\\') {
+      res += '\\';
+      res += c;
+    } else if (c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      res += buf;
+    } else {
+      res += c;
+    }
+  }
+  return res + "\"";
+}
+
+static std::string statsLine(Function *fun, const FunctionStatsTy& st) {
+  std::string res;
+  raw_string_ostream os(res);
+  os << "{\"function\":" << jsonString(funName(fun)) << ",\"states\":" << st.states << ",\"restarts\":" << st.restarts <<
+    ",\"peakStates\":" << st.peakStates << ",\"comparedEqual\":" << st.comparedEqual << ",\"comparedDifferent\":" << st.comparedDifferent <<
+    ",\"seconds\":" << format("%.6f", st.seconds) << ",\"exceeded\":" << (st.exceeded ? jsonString(st.exceeded) : "null") << "}\n";
+  return os.str();
+}
+
+// memory used by the states of the function being checked (full states and
+// their interned components are in the region)
+static size_t statesBytes() {
+  return stateRegion.size() + doneSet.size() * (sizeof(BcheckPackedStateTy) + 3 * sizeof(void*));
+    // done set node (with cached hash) and a bucket
+}
 
 void clearStates() {
   // clear the worklist and the doneset
   totalStates += doneSet.size();
-  for(DoneSetTy::iterator ds = doneSet.begin(), de = doneSet.end(); ds != de; ++ds) {
-    BcheckStateTy *old = *ds;
-    delete old;
-  }
   doneSet.clear();
-  WorkListTy empty;
-  std::swap(workList, empty);
-  // all elements in worklist are also in doneset, so no need to call destructors
+  componentTables.clear();
+  workList.clear();
+  visitedState = NULL;
+  stateEdges.clear();
+  stateMessages.clear();
+  emittedMessages.clear();
+  // the states in the worklist are not deleted one by one, their memory is
+  // released by resetting the region, which can only be done once the last
+  // state being visited is gone
 }
 
 void handleUnprotectWithIntGuard(Instruction *in, BcheckStateTy& s, GlobalsTy& g, IntGuardsChecker& intGuardsChecker, LineMessenger& msg, unsigned& refinableInfos) { 
@@ -331,37 +465,216 @@ struct ModuleCheckingStateTy {
   LineMessenger& msg;
   CalledModuleTy& cm;
   CProtectInfo& cprotect;
+  raw_ostream& err;
   
   ModuleCheckingStateTy(FunctionsSetTy& possibleAllocators, FunctionsSetTy& allocatingFunctions, FunctionsSetTy& errorFunctions,
-      GlobalsTy& gl, LineMessenger& msg, CalledModuleTy& cm, CProtectInfo& cprotect):
-    possibleAllocators(possibleAllocators), allocatingFunctions(allocatingFunctions), errorFunctions(errorFunctions), gl(gl), msg(msg), cm(cm), cprotect(cprotect) {};
+      GlobalsTy& gl, LineMessenger& msg, CalledModuleTy& cm, CProtectInfo& cprotect, raw_ostream& err = errs()):
+    possibleAllocators(possibleAllocators), allocatingFunctions(allocatingFunctions), errorFunctions(errorFunctions), gl(gl), msg(msg), cm(cm), cprotect(cprotect), err(err) {};
+    
+  ModuleCheckingStateTy(ModuleCheckingStateTy& other, LineMessenger& msg, raw_ostream& err): // shares module-wide results, but not the output
+    possibleAllocators(other.possibleAllocators), allocatingFunctions(other.allocatingFunctions), errorFunctions(other.errorFunctions), gl(other.gl), msg(msg),
+    cm(other.cm), cprotect(other.cprotect), err(err) {};
 };
 
 class FunctionChecker {
 
   Function *fun;
-  VarBoolCacheTy saveVarsCache;
-  VarBoolCacheTy counterVarsCache;
-  VarBoolCacheTy checkedVarsCache;
+  FunctionVarsTy& vars; // classification of local variables
   IntGuardsChecker intGuardsChecker;
   SEXPGuardsChecker sexpGuardsChecker;
-  BasicBlocksSetTy errorBasicBlocks;
+  const BasicBlocksSetTy& errorBasicBlocks;
   LiveVarsTy liveVars;
+  BasicBlocksSetTy intGuardSensitiveBlocks;
+  BasicBlocksSetTy sexpGuardSensitiveBlocks;
+  bool sensitiveBlocksFound;
+  const BcheckPackedStateTy* entryState;
+  TimePointTy start;
 
   ModuleCheckingStateTy& m;
 
-  void checkFunction(bool intGuardsEnabled, bool sexpGuardsEnabled, bool balanceCheckingEnabled, bool freshVarsCheckingEnabled, unsigned& refinableInfos) {
+  // find blocks which may be checked differently with integer (or SEXP) guards enabled
+  //   these are blocks with instructions that (transitively) use a guard variable,
+  //   and their operands; with SEXP guards, also variables used in vector-only
+  //   operations are tracked and calls with call arguments may get a different context
+  void findGuardSensitiveBlocks(bool sexp, BasicBlocksSetTy& blocks) {
+  
+    std::vector<Instruction*> pending;
+    std::unordered_set<Instruction*> sensitive;
+    
+    for(inst_iterator ini = inst_begin(*fun), ine = inst_end(*fun); ini != ine; ++ini) {
+      Instruction *in = &*ini;
+      AllocaInst *var = NULL;
+      
+      if (sexp && isVectorOnlyVarOperation(in, var)) {
+        pending.push_back(in);
+      }
+      if (!var) {
+        var = dyn_cast<AllocaInst>(in);
+        if (!var || !(sexp ? sexpGuardsChecker.isGuard(var) : intGuardsChecker.isGuard(var))) {
+          var = NULL;
+        }
+      }
+      if (var) {
+        for(Value::user_iterator ui = var->user_begin(), ue = var->user_end(); ui != ue; ++ui) {
+          if (Instruction *u = dyn_cast<Instruction>(*ui)) {
+            pending.push_back(u);
+          }
+        }
+      }
+      if (sexp) {
+        CallSite cs(in);
+        if (cs) {
+          for(CallSite::arg_iterator ai = cs.arg_begin(), ae = cs.arg_end(); ai != ae; ++ai) {
+            if (CallSite(ai->get())) {
+              pending.push_back(in);
+              break;
+            }
+          }
+        }
+      }
+    }
+    
+    while(!pending.empty()) {
+      Instruction *in = pending.back();
+      pending.pop_back();
+      if (!sensitive.insert(in).second) {
+        continue;
+      }
+      for(Value::user_iterator ui = in->user_begin(), ue = in->user_end(); ui != ue; ++ui) {
+        if (Instruction *u = dyn_cast<Instruction>(*ui)) {
+          pending.push_back(u);
+        }
+      }
+    }
+    
+    for(std::unordered_set<Instruction*>::iterator si = sensitive.begin(), se = sensitive.end(); si != se; ++si) {
+      Instruction *in = *si;
+      blocks.insert(in->getParent());
+      for(User::op_iterator oi = in->op_begin(), oe = in->op_end(); oi != oe; ++oi) {
+        if (Instruction *op = dyn_cast<Instruction>(oi->get())) {
+          blocks.insert(op->getParent());
+        }
+      }
+    }
+  }
+  
+  // when restarting with more precise guards, keep states that would be
+  // reached the same way with the new guards, that is states reachable from
+  // the entry only through visited blocks not sensitive to the new guards,
+  // and keep messages from visiting them; only states in sensitive blocks or
+  // not visited yet are put on the worklist again
+  void keepGuardIndependentStates(bool sexpGuardsNext) {
+  
+    if (!sensitiveBlocksFound) {
+      findGuardSensitiveBlocks(false, intGuardSensitiveBlocks);
+      findGuardSensitiveBlocks(true, sexpGuardSensitiveBlocks);
+      sensitiveBlocksFound = true;
+    }
+    BasicBlocksSetTy& sensitiveBlocks = sexpGuardsNext ? sexpGuardSensitiveBlocks : intGuardSensitiveBlocks;
+    
+    // the state being visited, if any, has not been fully visited
+    visitedState = NULL;
+    emittedMessages.clear();
+    
+    std::unordered_map<const BcheckPackedStateTy*, std::vector<const BcheckPackedStateTy*>> successors;
+    for(std::vector<StateEdgeTy>::iterator ei = stateEdges.begin(), ee = stateEdges.end(); ei != ee; ++ei) {
+      successors[ei->first].push_back(ei->second);
+    }
+    
+    // states to keep in the order they are found, so that checking stays deterministic
+    std::vector<const BcheckPackedStateTy*> kept;
+    std::unordered_set<const BcheckPackedStateTy*> keptSet;
+    
+    kept.push_back(entryState);
+    keptSet.insert(entryState);
+    for(unsigned i = 0; i < kept.size(); i++) {
+      const BcheckPackedStateTy* ps = kept[i];
+      if (!ps->visited || sensitiveBlocks.find(ps->bb) != sensitiveBlocks.end()) {
+        ps->visited = false;
+        continue;
+      }
+      std::vector<const BcheckPackedStateTy*>& succs = successors[ps];
+      for(std::vector<const BcheckPackedStateTy*>::iterator si = succs.begin(), se = succs.end(); si != se; ++si) {
+        if (keptSet.insert(*si).second) {
+          kept.push_back(*si);
+        }
+      }
+    }
+    
+    // keep only recorded visits of kept states
+    std::vector<StateEdgeTy> keptEdges;
+    for(std::vector<StateEdgeTy>::iterator ei = stateEdges.begin(), ee = stateEdges.end(); ei != ee; ++ei) {
+      if (ei->first->visited && keptSet.find(ei->first) != keptSet.end()) {
+        keptEdges.push_back(*ei);
+      }
+    }
+    stateEdges.swap(keptEdges);
+    
+    std::vector<StateMessageTy> keptMessages;
+    m.msg.logEmitted(NULL);
+    m.msg.clear();
+    for(std::vector<StateMessageTy>::iterator mi = stateMessages.begin(), me = stateMessages.end(); mi != me; ++mi) {
+      if (mi->first->visited && keptSet.find(mi->first) != keptSet.end()) {
+        keptMessages.push_back(*mi);
+        m.msg.emitInterned(mi->second);
+      }
+    }
+    stateMessages.swap(keptMessages);
+    
+    for(DoneSetTy::iterator di = doneSet.begin(), de = doneSet.end(); di != de;) {
+      if (keptSet.find(&*di) == keptSet.end()) {
+        totalStates++;
+        di = doneSet.erase(di);
+      } else {
+        ++di;
+      }
+    }
+    
+    while(!workList.empty()) {
+      delete workList.top();
+      workList.pop();
+    }
+    // with the default (dfs) strategy, the first kept state is visited first
+    for(std::vector<const BcheckPackedStateTy*>::reverse_iterator ki = kept.rbegin(), ke = kept.rend(); ki != ke; ++ki) {
+      const BcheckPackedStateTy* ps = *ki;
+      if (!ps->visited) {
+        workList.push(BcheckStateTy::unpack(*ps));
+      }
+    }
+  }
+
+  void checkFunction(bool intGuardsEnabled, bool sexpGuardsEnabled, bool balanceCheckingEnabled, bool freshVarsCheckingEnabled, unsigned& refinableInfos,
+    bool restarted) {
   
     refinableInfos = 0;
+    bool sexpGuardsNext = intGuardsEnabled || avoidIntGuardsFor(fun);
     bool restartable = (!intGuardsEnabled && !avoidIntGuardsFor(fun)) || (!sexpGuardsEnabled && !avoidSEXPGuardsFor(fun));
-    clearStates();
-    {
-      BcheckStateTy* initState = new BcheckStateTy(&fun->getEntryBlock());
-      initState->add();
+    if (!restarted) {
+      clearStates();
+      stateRegion.reset(); // no states from previous function or check are live now
+    }
+    workList.setFunction(fun);
+    StateRegion::Scope regionScope(&stateRegion);
+    if (!restarted) {
+      BcheckStateTy* s = new BcheckStateTy(&fun->getEntryBlock());
+      s->add();
+      entryState = s->packed;
     }
+    recordingVisits = restartable;
+    m.msg.logEmitted(restartable ? &emittedMessages : NULL);
+    
     while(!workList.empty()) {
+      if (visitedState && refinableInfos == 0) {
+        // the state has been fully visited
+        visitedState->visited = true;
+        for(std::vector<const LineInfoTy*>::iterator mi = emittedMessages.begin(), me = emittedMessages.end(); mi != me; ++mi) {
+          stateMessages.push_back({visitedState, *mi});
+        }
+        emittedMessages.clear();
+        visitedState = NULL;
+      }
       if (restartable && refinableInfos > 0) {
-        clearStates();
+        keepGuardIndependentStates(sexpGuardsNext);
         return;
       }
       
@@ -376,8 +689,12 @@ class FunctionChecker {
         workList.top()->dump();
       }
 
-      BcheckStateTy s(*workList.top());
+      std::unique_ptr<BcheckStateTy> sptr(workList.top());
+      BcheckStateTy& s = *sptr;
       workList.pop();
+      if (restartable) {
+        visitedState = s.packed;
+      }
       m.msg.trace("going to work on this state:", &*s.bb->begin());
       
       if (errorBasicBlocks.find(s.bb) != errorBasicBlocks.end()) {
@@ -385,8 +702,13 @@ class FunctionChecker {
         continue;
       }
       
-      if (doneSet.size() > MAX_STATES) {
-        errs() << "ERROR: too many states (abstraction error?) in function " << funName(fun) << "\n";
+      if (doneSet.size() > stats.peakStates) {
+        stats.peakStates = doneSet.size();
+      }
+      bool tooManyStates = stateBudget.exceeded(doneSet.size(), statesBytes());
+      if (tooManyStates || stateBudget.timeExceeded(start)) {
+        stats.exceeded = tooManyStates ? "states" : "time";
+        m.err << "ERROR: " << (tooManyStates ? "too many states" : "too much time") << " (abstraction error?) in function " << funName(fun) << "\n";
         clearStates();
         return;
       }
@@ -405,29 +727,29 @@ class FunctionChecker {
    
         if (freshVarsCheckingEnabled) {
           handleFreshVarsForNonTerminator(in, &m.cm, sexpGuardsEnabled ? &sexpGuardsChecker : NULL, sexpGuardsEnabled ? &s.sexpGuards : NULL, s.freshVars, 
-            m.msg, refinableInfos, liveVars, m.cprotect, balanceCheckingEnabled ? &s.balance : NULL, checkedVarsCache);
+            m.msg, refinableInfos, liveVars, m.cprotect, balanceCheckingEnabled ? &s.balance : NULL, vars);
               // NOTE: must be called before balance handling
               //  because it uses some state of balance handling that will be removed by the call to
               //  handleBalanceForNonTerminator, e.g. re protection counter or topsave variable
             
-          if (restartable && refinableInfos > 0) { clearStates(); return; }
+          if (restartable && refinableInfos > 0) { keepGuardIndependentStates(sexpGuardsNext); return; }
         }
         if (balanceCheckingEnabled) {
-          handleBalanceForNonTerminator(in, s.balance, m.gl, counterVarsCache, saveVarsCache, m.msg, refinableInfos);
-          if (restartable && refinableInfos > 0) { clearStates(); return; }
+          handleBalanceForNonTerminator(in, s.balance, m.gl, vars, m.msg, refinableInfos);
+          if (restartable && refinableInfos > 0) { keepGuardIndependentStates(sexpGuardsNext); return; }
         }
  
         if (intGuardsEnabled) {
           intGuardsChecker.handleForNonTerminator(in, s.intGuards);
-          if (restartable && refinableInfos > 0) { clearStates(); return; }
+          if (restartable && refinableInfos > 0) { keepGuardIndependentStates(sexpGuardsNext); return; }
           if (balanceCheckingEnabled) {
             handleUnprotectWithIntGuard(in, s, m.gl, intGuardsChecker, m.msg, refinableInfos);
-            if (restartable && refinableInfos > 0) { clearStates(); return; }
+            if (restartable && refinableInfos > 0) { keepGuardIndependentStates(sexpGuardsNext); return; }
           }
         }
         if (sexpGuardsEnabled) {
           sexpGuardsChecker.handleForNonTerminator(in, s.sexpGuards);
-          if (restartable && refinableInfos > 0) { clearStates(); return; }
+          if (restartable && refinableInfos > 0) { keepGuardIndependentStates(sexpGuardsNext); return; }
         }
       }
       
@@ -437,7 +759,7 @@ class FunctionChecker {
         handleFreshVarsForTerminator(t, s.freshVars, liveVars); // does nothing anyway
       }
 
-      if (balanceCheckingEnabled && handleBalanceForTerminator(t, s, m.gl, counterVarsCache, m.msg, refinableInfos)) {
+      if (balanceCheckingEnabled && handleBalanceForTerminator(t, s, m.gl, vars, m.msg, refinableInfos)) {
         // ignore successors in case important errors were already found, and hence further
         // errors found will just confuse the user
         continue;
@@ -464,17 +786,21 @@ class FunctionChecker {
         }
       }
     }
+    if (restartable && refinableInfos > 0) {
+      keepGuardIndependentStates(sexpGuardsNext);
+    }
   }
   
   public:
+    FunctionStatsTy stats; // except states and comparisons, which are counted by the caller
+    
     FunctionChecker(Function *fun, ModuleCheckingStateTy& moduleState): 
-        fun(fun), saveVarsCache(), counterVarsCache(), checkedVarsCache(), intGuardsChecker(&moduleState.msg), 
+        fun(fun), vars(*getModuleAnalyses(fun->getParent())->getFunctionVars(fun, &moduleState.gl, true)), intGuardsChecker(&moduleState.msg, &vars), 
         /* TODO: we would need "sure" allocators here instead of possible allocators! */
-        sexpGuardsChecker(&moduleState.msg, &moduleState.gl, 
+        sexpGuardsChecker(&moduleState.msg, &vars, &moduleState.gl, 
           USE_ALLOCATOR_DETECTION ? moduleState.cm.getContextSensitivePossibleAllocators() : NULL, moduleState.cm.getSymbolsMap(), NULL, moduleState.cm.getVrfState(), &moduleState.cm),
-        errorBasicBlocks(), m(moduleState) {
+        errorBasicBlocks(getModuleAnalyses(fun->getParent())->getErrorBasicBlocks(fun)), intGuardSensitiveBlocks(), sexpGuardSensitiveBlocks(), sensitiveBlocksFound(false), entryState(NULL), start(), m(moduleState), stats() {
         
-      findErrorBasicBlocks(fun, &m.errorFunctions, errorBasicBlocks);
       liveVars = findLiveVariables(fun);
     }  
   
@@ -485,14 +811,17 @@ class FunctionChecker {
       bool intGuardsEnabled = false;
       bool sexpGuardsEnabled = false;
       unsigned refinableInfos;
+      bool restarted = false;
+      start = timeNow();
     
       for(;;) {
-        checkFunction(intGuardsEnabled, sexpGuardsEnabled, balanceCheckingEnabled, freshVarsCheckingEnabled, refinableInfos);
+        checkFunction(intGuardsEnabled, sexpGuardsEnabled, balanceCheckingEnabled, freshVarsCheckingEnabled, refinableInfos, restarted);
     
         bool restartable = (!intGuardsEnabled && !avoidIntGuardsFor(fun)) || (!sexpGuardsEnabled && !avoidSEXPGuardsFor(fun));
         if (restartable && refinableInfos>0) {
-          // retry with more precise checking
-          m.msg.clear();
+          // retry with more precise checking, messages of kept states are already in m.msg
+          restarted = true;
+          stats.restarts++;
           if (!intGuardsEnabled && !avoidIntGuardsFor(fun)) {
             intGuardsEnabled = true;
           } else if (!sexpGuardsEnabled && !avoidSEXPGuardsFor(fun)) {
@@ -502,42 +831,166 @@ class FunctionChecker {
           break;
         }
       }
+      if (doneSet.size() > stats.peakStates) {
+        stats.peakStates = doneSet.size();
+      }
+      recordingVisits = false;
+      m.msg.logEmitted(NULL);
     }
 };
 
 
-// -------------------------------- main  -----------------------------------
+static FunctionStatsTy checkFunction(Function *fun, ModuleCheckingStateTy& mstate) {
 
-int main(int argc, char* argv[])
-{
-  LLVMContext context;
-  FunctionsOrderedSetTy functionsOfInterestSet;
-  FunctionsVectorTy functionsOfInterestVector;
+  TimePointTy start = timeNow();
+  unsigned long statesBefore = totalStates + doneSet.size(); // states of the previous function are counted when cleared
+  unsigned long equalBefore = nComparedEqual;
+  unsigned long differentBefore = nComparedDifferent;
+
+  FunctionChecker fchk(fun, mstate);
+
+  if (SEPARATE_CHECKING) {
+      // FIXME: it would make more sense to only print prefixes [BP] and [UP] with join checking
+    fchk.checkFunction(true, false, " [protection balance]");
+    fchk.checkFunction(false, true, " [unprotected pointers]");
+  } else {
+    fchk.checkFunction(true, true, "");  
+  }
   
-  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);
-//  EXCLUDE_PROTECTION_FUNCTIONS = (argc == 3); // exclude when checking modules
-  GlobalsTy gl(m);
-  LineMessenger msg(context, DEBUG, TRACE, UNIQUE_MSG);
+  FunctionStatsTy& st = fchk.stats;
+  st.states = totalStates + doneSet.size() - statesBefore;
+  st.comparedEqual = nComparedEqual - equalBefore;
+  st.comparedDifferent = nComparedDifferent - differentBefore;
+  st.seconds = secondsSince(start);
+  return st;
+}
+
+// output of checking a single function, when checking concurrently
+struct FunctionOutputTy {
+  std::string out;
+  std::string err;
+  std::string stats;
+  bool done;
   
-  FunctionsSetTy errorFunctions;
-  findErrorFunctions(m, errorFunctions);
+  FunctionOutputTy(): out(), err(), stats(), done(false) {};
+};
 
-  FunctionsSetTy possibleAllocators;
-  findPossibleAllocators(m, possibleAllocators);
+// check functions using nJobs threads, each thread takes the next unchecked function
+//   the output is printed in the order of the functions
+static unsigned long checkFunctionsConcurrently(FunctionsVectorTy& functions, ModuleCheckingStateTy& mstate, LLVMContext& context, unsigned nJobs,
+    std::ofstream* telemetry) {
 
-  FunctionsSetTy allocatingFunctions;
-  findAllocatingFunctions(m, allocatingFunctions);
+  unsigned nFunctions = functions.size();
+  std::vector<FunctionOutputTy> outputs(nFunctions);
+  std::atomic<unsigned> nextFunction(0);
+  std::atomic<unsigned long> nStates(0);
+  std::mutex outputsLock;
+  std::condition_variable outputReady;
+  
+  auto worker = [&]() {
+    for(;;) {
+      unsigned i = nextFunction++;
+      if (i >= nFunctions) {
+        break;
+      }
+      std::string out;
+      std::string err;
+      std::string stats;
+      {
+        raw_string_ostream outStream(out);
+        raw_string_ostream errStream(err);
+        LineMessenger msg(context, DEBUG, TRACE, UNIQUE_MSG, outStream);
+        ModuleCheckingStateTy wstate(mstate, msg, errStream);
+        
+        FunctionStatsTy st = checkFunction(functions[i], wstate);
+        if (telemetry) {
+          stats = statsLine(functions[i], st);
+        }
+        msg.flush();
+        outStream.flush();
+        errStream.flush();
+      }
+      {
+        std::lock_guard<std::mutex> lock(outputsLock);
+        outputs[i].out.swap(out);
+        outputs[i].err.swap(err);
+        outputs[i].stats.swap(stats);
+        outputs[i].done = true;
+      }
+      outputReady.notify_one();
+    }
+    clearStates();
+    stateRegion.reset();
+    nStates += totalStates;
+  };
+  
+  std::vector<std::thread> threads;
+  for(unsigned j = 0; j < nJobs; j++) {
+    threads.push_back(std::thread(worker));
+  }
+  
+  for(unsigned i = 0; i < nFunctions; i++) {
+    FunctionOutputTy& o = outputs[i];
+    {
+      std::unique_lock<std::mutex> lock(outputsLock);
+      outputReady.wait(lock, [&o] { return o.done; });
+    }
+    outs() << o.out;
+    if (!o.err.empty()) {
+      outs().flush();
+      errs() << o.err;
+    }
+    if (telemetry) {
+      *telemetry << o.stats;
+    }
+    std::string().swap(o.out);
+    std::string().swap(o.err);
+    std::string().swap(o.stats);
+  }
+  
+  for(std::vector<std::thread>::iterator ti = threads.begin(), te = threads.end(); ti != te; ++ti) {
+    ti->join();
+  }
+  return nStates;
+}
 
-  SymbolsMapTy symbolsMap;
-  findSymbols(m, &symbolsMap);
+// -------------------------------- main  -----------------------------------
+
+static std::unique_ptr<std::ofstream> telemetry;
+
+static void parseBcheckOptions(int& argc, char* argv[]) {
+
+  std::string telemetryArg;
+  if (extractOption(argc, argv, "--telemetry", telemetryArg)) {
+    telemetry.reset(new std::ofstream(telemetryArg));
+    if (!*telemetry) {
+      errs() << "ERROR: cannot open telemetry file " << telemetryArg << "\n";
+      exit(1);
+    }
+  }
+}
+
+static int runBcheck(Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
+
+  unsigned nJobs = getJobs();
+//  EXCLUDE_PROTECTION_FUNCTIONS = (argc == 3); // exclude when checking modules
+  GlobalsTy gl(m);
+  LineMessenger msg(context, DEBUG, TRACE, UNIQUE_MSG);
+  
+  ModuleAnalysesTy *analyses = getModuleAnalyses(m);
+  FunctionsSetTy& errorFunctions = *analyses->getErrorFunctions();
+  FunctionsSetTy& possibleAllocators = *analyses->getPossibleAllocators();
+  FunctionsSetTy& allocatingFunctions = *analyses->getAllocatingFunctions();
+  SymbolsMapTy& symbolsMap = *analyses->getSymbolsMap();
   
-  CalledModuleTy cm(m, &symbolsMap, &errorFunctions, &gl, &possibleAllocators, &allocatingFunctions);
+  CalledModuleTy cm(m, &symbolsMap, &errorFunctions, &gl, &possibleAllocators, &allocatingFunctions, &functionsOfInterestSet);
+    // demand-driven, only callees of the checked functions are needed
   CProtectInfo cprotect = findCalleeProtectFunctions(m, *cm.getContextSensitiveAllocatingFunctions());
   
   ModuleCheckingStateTy mstate(possibleAllocators, allocatingFunctions, errorFunctions, gl, msg, cm, cprotect); 
     // FIXME: perhaps get rid of ModuleCheckingState now that we have CalledModule
 
-  unsigned nAnalyzedFunctions = 0;
+  FunctionsVectorTy functionsToCheck;
   for(FunctionsVectorTy::iterator FI = functionsOfInterestVector.begin(), FE = functionsOfInterestVector.end(); FI != FE; ++FI) {
     Function *fun = *FI;
 
@@ -552,23 +1005,40 @@ int main(int argc, char* argv[])
       
       continue;
     }
-    
-    nAnalyzedFunctions++;
-    FunctionChecker fchk(fun, mstate);
+    functionsToCheck.push_back(fun);
+  }
+  
+  if (functionsToCheck.size() < nJobs) {
+    nJobs = std::max((unsigned) functionsToCheck.size(), 1U);
+  }
+  stateBudget = getStateBudget(DEFAULT_MAX_STATES, nJobs);
 
-    if (SEPARATE_CHECKING) {
-        // FIXME: it would make more sense to only print prefixes [BP] and [UP] with join checking
-      fchk.checkFunction(true, false, " [protection balance]");
-      fchk.checkFunction(false, true, " [unprotected pointers]");
-    } else {
-      fchk.checkFunction(true, true, "");  
+  unsigned long nStates;
+  if (nJobs > 1) {
+    cm.computeVectorReturningFunctions(); // otherwise computed lazily by the first checker
+    nStates = checkFunctionsConcurrently(functionsToCheck, mstate, context, nJobs, telemetry.get());
+  } else {
+    for(FunctionsVectorTy::iterator FI = functionsToCheck.begin(), FE = functionsToCheck.end(); FI != FE; ++FI) {
+      FunctionStatsTy st = checkFunction(*FI, mstate);
+      if (telemetry) {
+        *telemetry << statsLine(*FI, st);
+      }
     }
+    msg.flush();
+    clearStates();
+    stateRegion.reset();
+    nStates = totalStates;
   }
-  msg.flush();
-  clearStates();
-  delete m;
-
   outs().flush();
-  errs() << "Analyzed " << nAnalyzedFunctions << " functions, traversed " << totalStates << " states.\n";
+  errs() << "Analyzed " << functionsToCheck.size() << " functions, traversed " << nStates << " states.\n";
   return 0;
 }
+
+const ToolTy bcheckTool = { "bcheck", parseBcheckOptions, runBcheck };
+
+#ifndef RCHK_DRIVER
+int main(int argc, char* argv[])
+{
+  return runTool(argc, argv, bcheckTool);
+}
+#endif
@@ -0,0 +1,113 @@
+
+#include "budget.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <unistd.h>
+
+#include <llvm/Support/raw_ostream.h>
+
+using namespace llvm;
+
+const size_t MEMORY_PERCENT = 50; // percentage of available memory used for states by default
+
+static bool maxStatesGiven = false;
+static unsigned long maxStatesOption = 0;
+static bool maxBytesGiven = false;
+static size_t maxBytesOption = 0;
+static double maxSecondsOption = 0;
+
+static unsigned long long parseSize(const std::string& optName, const std::string& value, bool allowSuffix) {
+
+  char *end;
+  unsigned long long res = strtoull(value.c_str(), &end, 10);
+  if (end == value.c_str()) {
+    errs() << "ERROR: invalid value " << value << " for option " << optName << "\n";
+    exit(1);
+  }
+  if (allowSuffix) {
+    switch(*end) {
+      case 'k': case 'K': res <<= 10; end++; break;
+      case 'm': case 'M': res <<= 20; end++; break;
+      case 'g': case 'G': res <<= 30; end++; break;
+    }
+  }
+  if (*end != '\0') {
+    errs() << "ERROR: invalid value " << value << " for option " << optName << "\n";
+    exit(1);
+  }
+  return res;
+}
+
+void parseBudgetOptions(int& argc, char* argv[]) {
+
+  std::string value;
+  if (extractOption(argc, argv, "--max-states", value)) {
+    maxStatesOption = parseSize("--max-states", value, false);
+    maxStatesGiven = true;
+  }
+  if (extractOption(argc, argv, "--max-memory", value)) {
+    maxBytesOption = parseSize("--max-memory", value, true);
+    maxBytesGiven = true;
+  }
+  if (extractOption(argc, argv, "--max-time", value)) {
+    char *end;
+    maxSecondsOption = strtod(value.c_str(), &end);
+    if (end == value.c_str() || *end != '\0' || maxSecondsOption < 0) {
+      errs() << "ERROR: invalid value " << value << " for option --max-time\n";
+      exit(1);
+    }
+  }
+}
+
+TimePointTy timeNow() {
+  return std::chrono::steady_clock::now();
+}
+
+double secondsSince(TimePointTy start) {
+  return std::chrono::duration<double>(timeNow() - start).count();
+}
+
+bool StateBudgetTy::timeExceeded(TimePointTy start) const {
+  return maxSeconds && secondsSince(start) > maxSeconds;
+}
+
+size_t availableMemory() {
+
+  // MemAvailable (since Linux 3.14) includes memory that can be reclaimed
+  std::ifstream meminfo("/proc/meminfo");
+  std::string key;
+  unsigned long long kbytes;
+  std::string unit;
+  while (meminfo >> key >> kbytes >> unit) {
+    if (key == "MemAvailable:") {
+      return kbytes << 10;
+    }
+  }
+
+  long pages = sysconf(_SC_AVPHYS_PAGES);
+  long pageSize = sysconf(_SC_PAGESIZE);
+  if (pages > 0 && pageSize > 0) {
+    return (size_t) pages * pageSize;
+  }
+  return 0;
+}
+
+StateBudgetTy getStateBudget(unsigned long defaultMaxStates, unsigned nThreads) {
+
+  if (nThreads == 0) {
+    nThreads = 1;
+  }
+
+  // the defaults cap both the number of states and the memory, an option
+  // only replaces the limit it sets
+  unsigned long maxStates = maxStatesGiven ? maxStatesOption : defaultMaxStates;
+  size_t maxBytes;
+  if (maxBytesGiven) {
+    maxBytes = maxBytesOption;
+  } else {
+    static const size_t available = availableMemory();
+    maxBytes = available / 100 * MEMORY_PERCENT;
+  }
+  return StateBudgetTy(maxStates, maxBytes / nThreads, maxSecondsOption);
+}
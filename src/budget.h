@@ -0,0 +1,58 @@
+#ifndef RCHK_BUDGET_H
+#define RCHK_BUDGET_H
+
+#include "common.h"
+
+#include <chrono>
+#include <string>
+
+// limits on the number of states and on the memory used by states when
+// checking a single function (in bcheck, and in computing called allocators)
+//
+//   the limits are decided at runtime, from options
+//
+//     --max-states N     maximum number of states per function
+//     --max-memory SIZE  memory for states of all checking threads, SIZE can
+//                        have suffix K, M or G
+//     --max-time SECONDS wall-clock time for checking a function
+//
+//   or by default: the number of states is capped by a per-tool default
+//   (3M states in bcheck, 1M in computing called allocators) and the memory
+//   by half of the memory available at startup, there is no limit on the time
+//
+//   an option only replaces the limit it sets, 0 means no limit
+//
+//   when a function exceeds the budget, the tool reports "too many states"
+//   or "too much time"
+
+typedef std::chrono::steady_clock::time_point TimePointTy;
+
+struct StateBudgetTy {
+  unsigned long maxStates; // 0 means no limit
+  size_t maxBytes;         // 0 means no limit
+  double maxSeconds;       // 0 means no limit
+
+  StateBudgetTy(unsigned long maxStates, size_t maxBytes, double maxSeconds = 0): maxStates(maxStates), maxBytes(maxBytes), maxSeconds(maxSeconds) {};
+
+  bool exceeded(unsigned long nStates, size_t nBytes) const {
+    return (maxStates && nStates > maxStates) || (maxBytes && nBytes > maxBytes);
+  }
+
+  bool timeExceeded(TimePointTy start) const;
+};
+
+// wall-clock time
+TimePointTy timeNow();
+double secondsSince(TimePointTy start);
+
+// removes the budget options from the arguments
+void parseBudgetOptions(int& argc, char* argv[]);
+
+// budget for each of nThreads threads checking functions concurrently
+//   defaultMaxStates is used unless --max-states is given
+StateBudgetTy getStateBudget(unsigned long defaultMaxStates, unsigned nThreads = 1);
+
+// memory available at startup in bytes, or 0 if not known
+size_t availableMemory();
+
+#endif
@@ -1,6 +1,7 @@
 
 #include "callocators.h"
-#include "errors.h"
+#include "budget.h"
+#include "analyses.h"
 #include "guards.h"
 #include "symbols.h"
 #include "linemsg.h"
@@ -8,9 +9,12 @@
 #include "table.h"
 #include "exceptions.h"
 #include "patterns.h"
+#include "worklist.h"
 
+#include <algorithm>
+#include <atomic>
 #include <map>
-#include <stack>
+#include <thread>
 #include <unordered_set>
 
 #include <llvm/IR/CallSite.h>
@@ -24,7 +28,7 @@ using namespace llvm;
 const bool DEBUG = false;
 const bool TRACE = false;
 const bool UNIQUE_MSG = true;
-const int MAX_STATES = CALLOCATORS_MAX_STATES;
+const unsigned long DEFAULT_MAX_STATES = 1000000; // unless --max-states is given
 const bool VERBOSE_DUMP = false;
 
 const bool DUMP_STATES = false;
@@ -51,7 +55,7 @@ bool CalledFunctionTy::hasContext() const {
   return false;
 }
 
-std::string CalledFunctionTy::getNameSuffix() const {
+static std::string getArgInfoSuffix(const ArgInfosVectorTy *argInfo) {
 
   std::string suff;
   unsigned nKnown = 0;
@@ -66,7 +70,7 @@ std::string CalledFunctionTy::getNameSuffix() const {
       suff += ",";
     }
     if (a && a->isSymbol()) {
-      suff += "S:" + static_cast<const SymbolArgInfoTy*>(a)->symbolName;
+      suff += "S:" + static_cast<const SymbolArgInfoTy*>(a)->getSymbolName();
       nKnown++;
     } else if (a && a->isVector()) {
       suff += "V";
@@ -82,6 +86,9 @@ std::string CalledFunctionTy::getNameSuffix() const {
   return std::string();
 }
 
+std::string CalledFunctionTy::getNameSuffix() const {
+  return getArgInfoSuffix(argInfo);
+}
 
 std::string CalledFunctionTy::getName() const {
   return fun->getName().str() + getNameSuffix();
@@ -109,7 +116,7 @@ size_t ArgInfosVectorTy_hash::operator()(const ArgInfosVectorTy& t) const {
   for(ArgInfosVectorTy::const_iterator ai = t.begin(), ae = t.end(); ai != ae; ++ai) {
     const ArgInfoTy *a = *ai;
     if (a && a->isSymbol()) {
-      hash_combine(res, static_cast<const SymbolArgInfoTy*>(a)->symbolName);
+      hash_combine(res, static_cast<const SymbolArgInfoTy*>(a)->symbol);
       cntSym++;
     } else if (a && a->isVector()) {
       hash_combine(res, true);
@@ -122,34 +129,124 @@ size_t ArgInfosVectorTy_hash::operator()(const ArgInfosVectorTy& t) const {
 }
 
 const CalledFunctionTy* CalledModuleTy::getCalledFunction(Function *f) {
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
   size_t nargs = f->arg_size();
   ArgInfosVectorTy argInfos(nargs, NULL);
   CalledFunctionTy calledFunction(f, intern(argInfos), this);
   return intern(calledFunction);
 }
 
-const CalledFunctionTy* CalledModuleTy::getCalledFunction(Value *inst, bool registerCallSite) {
-  return getCalledFunction(inst, NULL, NULL, registerCallSite);
+// finds arguments that can influence the analysis of the function: the
+// context (known symbol or vector argument) is only used when the argument
+// is stored into a SEXP guard variable, so calls that differ only in other
+// arguments can be represented by the same called function
+
+static void findRelevantArgs(Function *f, GlobalsTy* g, CalledModuleTy* cm, std::vector<bool>& relevant) {
+
+  if (hasContextSensitiveException(f)) {
+    relevant.assign(f->arg_size(), true);
+    return;
+  }
+  relevant.assign(f->arg_size(), false);
+  if (avoidSEXPGuardsFor(f)) {
+    return;
+  }
+  for(inst_iterator ii = inst_begin(*f), ie = inst_end(*f); ii != ie; ++ii) {
+    StoreInst *store = dyn_cast<StoreInst>(&*ii);
+    if (!store) {
+      continue;
+    }
+    AllocaInst *var = dyn_cast<AllocaInst>(store->getPointerOperand());
+    if (!var) {
+      continue;
+    }
+    Value *v = store->getValueOperand();
+    CallSite cs(v);
+    if (cs) {
+      Function *pfun = cs.getCalledFunction();
+      if (pfun && (pfun->getName() == "Rf_protect" || pfun->getName() == "Rf_protectWithIndex")) {
+        v = cs.getArgument(0); // as in SEXPGuardsChecker::handleForNonTerminator
+      }
+    }
+    Argument *arg = dyn_cast<Argument>(v);
+    if (arg && isSEXPGuardVariable(var, g)) {
+      relevant[arg->getArgNo()] = true;
+    }
+  }
 }
 
-const CalledFunctionTy* CalledModuleTy::getCalledFunction(Value *inst, SEXPGuardsChecker* sexpGuardsChecker, SEXPGuardsTy *sexpGuards, bool registerCallSite) {
-  // FIXME: this is quite inefficient, does a lot of allocation
-  
-  CallSite cs (inst);
-  if (!cs) {
-    return NULL;
+const std::vector<bool>& CalledModuleTy::getRelevantArgs(Function *f) {
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  auto rsearch = relevantArgs.find(f);
+  if (rsearch != relevantArgs.end()) {
+    return rsearch->second;
   }
-  Function *fun = cs.getCalledFunction();
-  if (!fun) {
+  std::vector<bool>& relevant = relevantArgs[f];
+  findRelevantArgs(f, globals, this, relevant);
+  return relevant;
+}
+
+const CalledFunctionTy* CalledModuleTy::getCalledFunction(const CalledFunctionKeyTy& key) {
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+  Function *f = m->getFunction(key[0]);
+  if (!f || f->arg_size() != key.size() - 1) {
     return NULL;
   }
-      
-  // build arginfo
-      
+  ArgInfosVectorTy argInfos(key.size() - 1, NULL);
+  const std::vector<bool>& relevant = getRelevantArgs(f);
+  for(unsigned i = 1; i < key.size(); i++) {
+    const std::string& a = key[i];
+    if (!relevant[i - 1]) {
+      continue;
+    }
+    if (a == "V") {
+      argInfos[i - 1] = VectorArgInfoTy::get();
+    } else if (!a.empty() && a[0] == 'S') {
+      SymbolIdTy symbol;
+      if (!findSymbol(a.substr(1), symbol)) {
+        return NULL; // no such install call in the module
+      }
+      argInfos[i - 1] = SymbolArgInfoTy::create(symbol);
+    }
+  }
+  CalledFunctionTy calledFunction(f, intern(argInfos), this);
+  return intern(calledFunction);
+}
+
+CalledFunctionKeyTy CalledModuleTy::getKey(const CalledFunctionTy* cf) {
+  CalledFunctionKeyTy key;
+  key.push_back(cf->fun->getName().str());
+  for(ArgInfosVectorTy::const_iterator ai = cf->argInfo->begin(), ae = cf->argInfo->end(); ai != ae; ++ai) {
+    const ArgInfoTy *a = *ai;
+    if (a && a->isSymbol()) {
+      key.push_back("S" + static_cast<const SymbolArgInfoTy*>(a)->getSymbolName());
+    } else if (a && a->isVector()) {
+      key.push_back("V");
+    } else {
+      key.push_back("?");
+    }
+  }
+  return key;
+}
+
+const CalledFunctionTy* CalledModuleTy::getCalledFunction(Value *inst, bool registerCallSite) {
+  return getCalledFunction(inst, NULL, NULL, registerCallSite);
+}
+
+// builds the context of the call from the arguments, with onlyRelevant
+// only from those relevant to the analysis of the called function
+
+void CalledModuleTy::computeArgInfo(CallSite& cs, SEXPGuardsChecker* sexpGuardsChecker, SEXPGuardsTy *sexpGuards, ArgInfosVectorTy& argInfo, bool onlyRelevant) {
+
+  Function *fun = cs.getCalledFunction();
   unsigned nargs = cs.arg_size();
-  ArgInfosVectorTy argInfo(nargs, NULL);
+  argInfo.assign(nargs, NULL);
+  const std::vector<bool>* relevant = onlyRelevant ? &getRelevantArgs(fun) : NULL;
 
   for(unsigned i = 0; i < nargs; i++) {
+    if (relevant && (i >= relevant->size() || !(*relevant)[i])) {
+      continue; // contexts differing only in this argument collapse
+    }
     Value *arg = cs.getArgument(i);
     if (LoadInst::classof(arg)) { // R_XSymbol
       Value *src = cast<LoadInst>(arg)->getPointerOperand();
@@ -163,10 +260,10 @@ const CalledFunctionTy* CalledModuleTy::getCalledFunction(Value *inst, SEXPGuard
       if (sexpGuards && sexpGuardsChecker && AllocaInst::classof(src)) {
         AllocaInst *var = cast<AllocaInst>(src);
           
-        std::string symbolName;
-        SEXPGuardState gs = sexpGuardsChecker->getGuardState(*sexpGuards, var, symbolName);
+        SymbolIdTy symbol;
+        SEXPGuardState gs = sexpGuardsChecker->getGuardState(*sexpGuards, var, symbol);
         if (gs == SGS_SYMBOL) {
-          argInfo[i] = SymbolArgInfoTy::create(symbolName);
+          argInfo[i] = SymbolArgInfoTy::create(symbol);
           continue;
         }
         if (gs == SGS_VECTOR) {
@@ -175,9 +272,9 @@ const CalledFunctionTy* CalledModuleTy::getCalledFunction(Value *inst, SEXPGuard
         }
       }
     }
-    std::string symbolName;  // install("X")
-    if (isInstallConstantCall(arg, symbolName)) {
-      argInfo[i] = SymbolArgInfoTy::create(symbolName);
+    SymbolIdTy symbol;  // install("X")
+    if (isInstallConstantCall(arg, symbol)) {
+      argInfo[i] = SymbolArgInfoTy::create(symbol);
       continue;
     }
     if (isVectorProducingCall(arg, this, sexpGuardsChecker, sexpGuards)) {
@@ -186,11 +283,191 @@ const CalledFunctionTy* CalledModuleTy::getCalledFunction(Value *inst, SEXPGuard
     }
     // not a symbol, leave argInfo as NULL
   }
+}
+
+// builds the (collapsed) context of the call and interns the called function
+
+const CalledFunctionTy* CalledModuleTy::computeCalledFunction(CallSite& cs, SEXPGuardsChecker* sexpGuardsChecker, SEXPGuardsTy *sexpGuards) {
+
+  ArgInfosVectorTy argInfo;
+  computeArgInfo(cs, sexpGuardsChecker, sexpGuards, argInfo, true);
       
-  CalledFunctionTy calledFunction(fun, intern(argInfo), this);
-  const CalledFunctionTy* cf = intern(calledFunction);
+  CalledFunctionTy calledFunction(cs.getCalledFunction(), intern(argInfo), this);
+  return intern(calledFunction);
+}
+
+// the name of the called function as given in messages: the context lists all
+// known arguments, as the collapsed context of getCalledFunction may leave
+// out some, which would make the messages depend on the collapsing
+
+std::string CalledModuleTy::getCallName(Value *inst, SEXPGuardsChecker* sexpGuardsChecker, SEXPGuardsTy *sexpGuards) {
+
+  CallSite cs (inst);
+  if (!cs) {
+    return std::string();
+  }
+  Function *fun = cs.getCalledFunction();
+  if (!fun) {
+    return std::string();
+  }
+  if (!sexpGuardsChecker) {
+    sexpGuards = NULL;
+  }
+
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock); // vector-returning functions state
+  ArgInfosVectorTy argInfo;
+  computeArgInfo(cs, sexpGuardsChecker, sexpGuards, argInfo, false);
+  return fun->getName().str() + getArgInfoSuffix(&argInfo);
+}
+
+// variables whose guard states may influence the context of the call: those
+// passed as (relevant) arguments and those used by calls nested in arguments,
+// see isVectorProducingCall
+
+void CalledModuleTy::findContextVars(Value *inst, std::vector<AllocaInst*>& vars, bool nested) {
+  CallSite cs(inst);
+  if (!cs || !cs.getCalledFunction()) {
+    return;
+  }
+  const std::vector<bool>& relevant = getRelevantArgs(cs.getCalledFunction());
+  unsigned nargs = cs.arg_size();
+  for(unsigned i = 0; i < nargs; i++) {
+    if (!nested && (i >= relevant.size() || !relevant[i])) {
+      continue;
+    }
+    Value *arg = cs.getArgument(i);
+    if (LoadInst *li = dyn_cast<LoadInst>(arg)) {
+      AllocaInst *var = dyn_cast<AllocaInst>(li->getPointerOperand());
+      if (var && std::find(vars.begin(), vars.end(), var) == vars.end()) {
+        vars.push_back(var);
+      }
+      continue;
+    }
+    findContextVars(arg, vars, true);
+  }
+}
+
+const unsigned MAX_CALL_SITE_CONTEXTS = 16; // per call site
+
+static bool guardsMatch(const CallSiteContextTy& c, const std::vector<AllocaInst*>& vars, SEXPGuardsTy *sexpGuards) {
+  if (c.withGuards != (sexpGuards != NULL)) {
+    return false;
+  }
+  if (!sexpGuards) {
+    return true;
+  }
+  for(unsigned i = 0; i < vars.size(); i++) {
+    const CallSiteGuardTy& cg = c.guards[i];
+    auto gsearch = sexpGuards->find(vars[i]);
+    if (gsearch == sexpGuards->end()) {
+      if (cg.state != SGS_UNKNOWN) {
+        return false;
+      }
+      continue;
+    }
+    const SEXPGuardTy& g = gsearch->second;
+    if (g.state != cg.state) {
+      return false;
+    }
+    if (g.state == SGS_SYMBOL && g.symbol != cg.symbol) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// a cache hit only needs the call site caches lock in shared mode, so that
+// concurrent checking threads do not serialize on the shared state lock;
+// returns NULL on a miss, or when the target still has to be registered
+
+const CalledFunctionTy* CalledModuleTy::findCachedCalledFunction(Value *inst, SEXPGuardsTy *sexpGuards, bool registerCallSite) {
+
+  std::shared_lock<std::shared_timed_mutex> lock(callSiteCachesLock);
+  auto csearch = callSiteCaches.find(inst);
+  if (csearch == callSiteCaches.end()) {
+    return NULL;
+  }
+  const CallSiteCacheTy& cache = csearch->second;
+
+  for(std::vector<CallSiteContextTy>::const_iterator ci = cache.contexts.begin(), ce = cache.contexts.end(); ci != ce; ++ci) {
+    if (!guardsMatch(*ci, cache.vars, sexpGuards)) {
+      continue;
+    }
+    const CalledFunctionTy* cf = ci->calledFunction;
+    if (registerCallSite) {
+      auto tsearch = callSiteTargets.find(inst);
+      if (tsearch == callSiteTargets.end() || tsearch->second.find(cf) == tsearch->second.end()) {
+        return NULL;
+      }
+    }
+    return cf;
+  }
+  return NULL;
+}
+
+const CalledFunctionTy* CalledModuleTy::getCalledFunction(Value *inst, SEXPGuardsChecker* sexpGuardsChecker, SEXPGuardsTy *sexpGuards, bool registerCallSite) {
+  
+  CallSite cs (inst);
+  if (!cs) {
+    return NULL;
+  }
+  Function *fun = cs.getCalledFunction();
+  if (!fun) {
+    return NULL;
+  }
+  if (!sexpGuardsChecker) {
+    sexpGuards = NULL;
+  }
+
+  const CalledFunctionTy* cached = findCachedCalledFunction(inst, sexpGuards, registerCallSite);
+  if (cached) {
+    return cached;
+  }
+
+  // the call site caches are only updated under this lock, so they can be
+  // read here without the call site caches lock
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock); // interning, vector-returning functions state, call site caches
+  
+  auto csearch = callSiteCaches.find(inst);
+  if (csearch == callSiteCaches.end()) {
+    std::vector<AllocaInst*> vars;
+    findContextVars(inst, vars, false);
+
+    std::unique_lock<std::shared_timed_mutex> clock(callSiteCachesLock);
+    csearch = callSiteCaches.insert({inst, CallSiteCacheTy()}).first;
+    csearch->second.vars = vars;
+  }
+  CallSiteCacheTy& cache = csearch->second; // references into the map stay valid
+  
+  const CalledFunctionTy* cf = NULL;
+  for(std::vector<CallSiteContextTy>::iterator ci = cache.contexts.begin(), ce = cache.contexts.end(); ci != ce; ++ci) {
+    if (guardsMatch(*ci, cache.vars, sexpGuards)) {
+      cf = ci->calledFunction;
+      break;
+    }
+  }
+  
+  if (!cf) {
+    cf = computeCalledFunction(cs, sexpGuardsChecker, sexpGuards);
+    if (cache.contexts.size() < MAX_CALL_SITE_CONTEXTS) {
+      CallSiteContextTy c;
+      c.withGuards = (sexpGuards != NULL);
+      c.calledFunction = cf;
+      if (sexpGuards) {
+        for(std::vector<AllocaInst*>::iterator vi = cache.vars.begin(), ve = cache.vars.end(); vi != ve; ++vi) {
+          CallSiteGuardTy cg;
+          cg.symbol = 0;
+          cg.state = sexpGuardsChecker->getGuardState(*sexpGuards, *vi, cg.symbol);
+          c.guards.push_back(cg);
+        }
+      }
+      std::unique_lock<std::shared_timed_mutex> clock(callSiteCachesLock);
+      cache.contexts.push_back(c);
+    }
+  }
   
   if (registerCallSite) {
+    std::unique_lock<std::shared_timed_mutex> clock(callSiteCachesLock);
     auto csearch = callSiteTargets.find(inst);
     if (csearch == callSiteTargets.end()) {
       CalledFunctionsSetTy newSet;
@@ -206,19 +483,34 @@ const CalledFunctionTy* CalledModuleTy::getCalledFunction(Value *inst, SEXPGuard
 }
 
 CalledModuleTy::CalledModuleTy(Module *m, SymbolsMapTy *symbolsMap, FunctionsSetTy* errorFunctions, GlobalsTy* globals, 
-  FunctionsSetTy* possibleAllocators, FunctionsSetTy* allocatingFunctions):
+  FunctionsSetTy* possibleAllocators, FunctionsSetTy* allocatingFunctions, const FunctionsOrderedSetTy* roots):
   
   m(m), symbolsMap(symbolsMap), errorFunctions(errorFunctions), globals(globals), possibleAllocators(possibleAllocators), allocatingFunctions(allocatingFunctions),
-  callSiteTargets(), vrfState(NULL), gcFunction(getCalledFunction(getGCFunction(m)))  {
-
-  for(Module::iterator fi = m->begin(), fe = m->end(); fi != fe; ++fi) {
-    Function *fun = &*fi;
+  callSiteTargets(), vrfState(NULL), recordedSnapshot(NULL), roots(roots), gcFunction(getCalledFunction(getGCFunction(m)))  {
 
-    myassert(fun);
-    getCalledFunction(fun); // make sure each function has a called function counterpart
-    for(Value::user_iterator ui = fun->user_begin(), ue = fun->user_end(); ui != ue; ++ui) {
-      User *u = *ui;
-      getCalledFunction(cast<Value>(u)); // NOTE: this only gets contexts that are constant, more are gotten during allocators computation
+  if (roots) {
+    // only start from the roots, called functions reachable from them are
+    // discovered during allocators computation
+    for(FunctionsOrderedSetTy::const_iterator fi = roots->begin(), fe = roots->end(); fi != fe; ++fi) {
+      Function *fun = *fi;
+      
+      myassert(fun);
+      getCalledFunction(fun);
+      for(inst_iterator ii = inst_begin(*fun), ie = inst_end(*fun); ii != ie; ++ii) {
+        Instruction *in = &*ii;
+        getCalledFunction(cast<Value>(in)); // constant contexts
+      }
+    }
+  } else {
+    for(Module::iterator fi = m->begin(), fe = m->end(); fi != fe; ++fi) {
+      Function *fun = &*fi;
+
+      myassert(fun);
+      getCalledFunction(fun); // make sure each function has a called function counterpart
+      for(Value::user_iterator ui = fun->user_begin(), ue = fun->user_end(); ui != ue; ++ui) {
+        User *u = *ui;
+        getCalledFunction(cast<Value>(u)); // NOTE: this only gets contexts that are constant, more are gotten during allocators computation
+      }
     }
   }
     // only compute on demand - it takes a bit of time
@@ -247,34 +539,21 @@ CalledModuleTy::~CalledModuleTy() {
   }
 }
 
-CalledModuleTy* CalledModuleTy::create(Module *m) {
-  SymbolsMapTy *symbolsMap = new SymbolsMapTy();
-  findSymbols(m, symbolsMap);
-
-  FunctionsSetTy *errorFunctions = new FunctionsSetTy();
-  findErrorFunctions(m, *errorFunctions);
+CalledModuleTy* CalledModuleTy::create(Module *m, const FunctionsOrderedSetTy* roots) {
+  ModuleAnalysesTy *analyses = getModuleAnalyses(m);
   GlobalsTy *globals = new GlobalsTy(m);
-  
-  FunctionsSetTy *possibleAllocators = new FunctionsSetTy();
-  findPossibleAllocators(m, *possibleAllocators);
 
-  FunctionsSetTy *allocatingFunctions = new FunctionsSetTy();
-  findAllocatingFunctions(m, *allocatingFunctions);
-
-  return new CalledModuleTy(m, symbolsMap, errorFunctions, globals, possibleAllocators, allocatingFunctions);
+  return new CalledModuleTy(m, analyses->getSymbolsMap(), analyses->getErrorFunctions(), globals, analyses->getPossibleAllocators(),
+    analyses->getAllocatingFunctions(), roots);
 }
 
 void CalledModuleTy::release(CalledModuleTy *cm) {
-  delete cm->getAllocatingFunctions();
-  delete cm->getPossibleAllocators();
+  // the symbols, error functions and allocators are owned by the module analyses
   delete cm->getGlobals();
-  delete cm->getErrorFunctions();
-  delete cm->getSymbolsMap();
   delete cm;
 }
 
 typedef std::map<AllocaInst*,const CalledFunctionsOrderedSetTy*> InternedVarOriginsTy;
-typedef std::map<AllocaInst*,CalledFunctionsOrderedSetTy> VarOriginsTy; // uninterned
 
   // for a local variable, a list of functions whose return values may have
   // been assigned, possibly indirectly, to that variable
@@ -298,60 +577,78 @@ struct CAllocStateTy;
 
 struct CAllocPackedStateTy : public PackedStateWithGuardsTy {
   const size_t hashcode;
+  const size_t intGuardsHash; // so that unmodified guards do not have to be unpacked to hash a successor
+  const size_t sexpGuardsHash;
   const CalledFunctionsOrderedSetTy *called;
   const InternedVarOriginsTy varOrigins;
   
   
-  CAllocPackedStateTy(size_t hashcode, BasicBlock* bb, const PackedIntGuardsTy& intGuards, const PackedSEXPGuardsTy& sexpGuards,
+  CAllocPackedStateTy(size_t hashcode, size_t intGuardsHash, size_t sexpGuardsHash, BasicBlock* bb, const PackedIntGuardsTy& intGuards, const PackedSEXPGuardsTy& sexpGuards,
     const InternedVarOriginsTy& varOrigins, const CalledFunctionsOrderedSetTy *called):
     
-    PackedStateBaseTy(bb), PackedStateWithGuardsTy(bb, intGuards, sexpGuards), hashcode(hashcode), called(called), varOrigins(varOrigins)  {};
+    PackedStateBaseTy(bb), PackedStateWithGuardsTy(bb, intGuards, sexpGuards), hashcode(hashcode), intGuardsHash(intGuardsHash), sexpGuardsHash(sexpGuardsHash),
+    called(called), varOrigins(varOrigins)  {};
     
   static CAllocPackedStateTy create(CAllocStateTy& us, IntGuardsChecker& intGuardsChecker, SEXPGuardsChecker& sexpGuardsChecker);
 };
 
-static VarOriginsTy unpackVarOrigins(const InternedVarOriginsTy& internedOrigins) {
-
-  VarOriginsTy varOrigins;
-
-  for(InternedVarOriginsTy::const_iterator oi = internedOrigins.begin(), oe = internedOrigins.end(); oi != oe; ++oi) {
-    AllocaInst* var = oi->first;
-    const CalledFunctionsOrderedSetTy* srcs = oi->second;
-    varOrigins.insert({var, *srcs});
-  }
-  
-  return varOrigins;
-}
-
-static CalledFunctionsOSTableTy osTable; // interned ordered sets
-
-static InternedVarOriginsTy packVarOrigins(const VarOriginsTy& varOrigins) {
+static thread_local CalledFunctionsOSTableTy osTable; // interned ordered sets
 
-  InternedVarOriginsTy internedOrigins;
-
-  for(VarOriginsTy::const_iterator oi = varOrigins.begin(), oe = varOrigins.end(); oi != oe; ++oi) {
-    AllocaInst* var = oi->first;
-    const CalledFunctionsOrderedSetTy& srcs = oi->second;
-    internedOrigins.insert({var, osTable.intern(srcs)});
-  }
-  
-  return internedOrigins;
-}
+// a state taken from the worklist is not unpacked as a whole: the guards are
+// only unpacked when the basic block may read or modify them, and the
+// origins are only copied when modified; the components not unpacked are
+// taken from the packed state also when packing the successors
+//
+// origins of variables are interned sets, an origin set is never modified,
+// only replaced
 
 struct CAllocStateTy : public StateWithGuardsTy {
   CalledFunctionsOrderedSetTy called;
-  VarOriginsTy varOrigins;
+  const CAllocPackedStateTy* packed; // source of components not unpacked, or NULL
+  bool intGuardsUnpacked;
+  bool sexpGuardsUnpacked;
+  bool varOriginsCopied;
+  InternedVarOriginsTy copiedVarOrigins; // valid when varOriginsCopied
   
-  CAllocStateTy(const CAllocPackedStateTy& ps, IntGuardsChecker& intGuardsChecker, SEXPGuardsChecker& sexpGuardsChecker):
-    CAllocStateTy(ps.bb, intGuardsChecker.unpack(ps.intGuards), sexpGuardsChecker.unpack(ps.sexpGuards), *ps.called, unpackVarOrigins(ps.varOrigins)) {};
+  CAllocStateTy(const CAllocPackedStateTy* ps):
+    StateBaseTy(ps->bb), StateWithGuardsTy(ps->bb), called(*ps->called), packed(ps), intGuardsUnpacked(false), sexpGuardsUnpacked(false),
+    varOriginsCopied(false), copiedVarOrigins() {};
 
-  CAllocStateTy(BasicBlock *bb): StateBaseTy(bb), StateWithGuardsTy(bb), called(), varOrigins() {};
+  CAllocStateTy(BasicBlock *bb): StateBaseTy(bb), StateWithGuardsTy(bb), called(), packed(NULL), intGuardsUnpacked(true), sexpGuardsUnpacked(true),
+    varOriginsCopied(true), copiedVarOrigins() {};
 
-  CAllocStateTy(BasicBlock *bb, const IntGuardsTy& intGuards, const SEXPGuardsTy& sexpGuards, const CalledFunctionsOrderedSetTy& called, const VarOriginsTy& varOrigins):
-    StateBaseTy(bb), StateWithGuardsTy(bb, intGuards, sexpGuards), called(called), varOrigins(varOrigins) {};
+  CAllocStateTy(BasicBlock *newBB, const CAllocStateTy& s):
+    StateBaseTy(newBB), StateWithGuardsTy(newBB, s.intGuards, s.sexpGuards), called(s.called), packed(s.packed), intGuardsUnpacked(s.intGuardsUnpacked),
+    sexpGuardsUnpacked(s.sexpGuardsUnpacked), varOriginsCopied(s.varOriginsCopied), copiedVarOrigins(s.copiedVarOrigins) {};
       
   virtual CAllocStateTy* clone(BasicBlock *newBB) {
-    return new CAllocStateTy(newBB, intGuards, sexpGuards, called, varOrigins);
+    return new CAllocStateTy(newBB, *this);
+  }
+  
+  void unpackIntGuards(IntGuardsChecker& intGuardsChecker) {
+    if (!intGuardsUnpacked) {
+      intGuards = intGuardsChecker.unpack(packed->intGuards);
+      intGuardsUnpacked = true;
+    }
+  }
+
+  void unpackSEXPGuards(SEXPGuardsChecker& sexpGuardsChecker) {
+    if (!sexpGuardsUnpacked) {
+      sexpGuards = sexpGuardsChecker.unpack(packed->sexpGuards);
+      sexpGuardsUnpacked = true;
+    }
+  }
+  
+  const InternedVarOriginsTy& varOrigins() const {
+    return varOriginsCopied ? copiedVarOrigins : packed->varOrigins;
+  }
+  
+  InternedVarOriginsTy& modifiedVarOrigins() { // copy on write
+    if (!varOriginsCopied) {
+      copiedVarOrigins = packed->varOrigins;
+      varOriginsCopied = true;
+    }
+    return copiedVarOrigins;
   }
     
   void dump(std::string dumpMsg) {
@@ -366,9 +663,10 @@ struct CAllocStateTy : public StateWithGuardsTy {
       }
     }
     errs() << "=== origins (allocators):\n";
-    for(VarOriginsTy::const_iterator oi = varOrigins.begin(), oe = varOrigins.end(); oi != oe; ++oi) {
+    const InternedVarOriginsTy& origins = varOrigins();
+    for(InternedVarOriginsTy::const_iterator oi = origins.begin(), oe = origins.end(); oi != oe; ++oi) {
       AllocaInst* var = oi->first;
-      const CalledFunctionsOrderedSetTy& srcs = oi->second;
+      const CalledFunctionsOrderedSetTy& srcs = *oi->second;
 
       errs() << "   " << varName(var) << ":";
         
@@ -387,21 +685,74 @@ struct CAllocStateTy : public StateWithGuardsTy {
 
 CAllocPackedStateTy CAllocPackedStateTy::create(CAllocStateTy& us, IntGuardsChecker& intGuardsChecker, SEXPGuardsChecker& sexpGuardsChecker) {
 
-  InternedVarOriginsTy internedOrigins = packVarOrigins(us.varOrigins);
+  size_t intHash = 0;
+  size_t sexpHash = 0;
+  if (us.intGuardsUnpacked) {
+    intGuardsChecker.hash(intHash, us.intGuards);
+  } else {
+    intHash = us.packed->intGuardsHash;
+  }
+  if (us.sexpGuardsUnpacked) {
+    sexpGuardsChecker.hash(sexpHash, us.sexpGuards);
+  } else {
+    sexpHash = us.packed->sexpGuardsHash;
+  }
+  const InternedVarOriginsTy& origins = us.varOrigins();
    
   size_t res = 0;
   hash_combine(res, us.bb);
-  intGuardsChecker.hash(res, us.intGuards);
-  sexpGuardsChecker.hash(res, us.sexpGuards);
+  hash_combine(res, intHash);
+  hash_combine(res, sexpHash);
     
-  hash_combine(res, internedOrigins.size());
-  for(InternedVarOriginsTy::const_iterator oi = internedOrigins.begin(), oe = internedOrigins.end(); oi != oe; ++oi) {
+  hash_combine(res, origins.size());
+  for(InternedVarOriginsTy::const_iterator oi = origins.begin(), oe = origins.end(); oi != oe; ++oi) {
     //AllocaInst* var = oi->first;
     const CalledFunctionsOrderedSetTy* srcs = oi->second;
     hash_combine(res, (const void *)srcs); // interned
   } // ordered map
     
-  return CAllocPackedStateTy(res, us.bb, intGuardsChecker.pack(us.intGuards), sexpGuardsChecker.pack(us.sexpGuards), internedOrigins, osTable.intern(us.called));
+  return CAllocPackedStateTy(res, intHash, sexpHash, us.bb,
+    us.intGuardsUnpacked ? intGuardsChecker.pack(us.intGuards) : us.packed->intGuards,
+    us.sexpGuardsUnpacked ? sexpGuardsChecker.pack(us.sexpGuards) : us.packed->sexpGuards,
+    origins, osTable.intern(us.called));
+}
+
+// which guards may be read or modified in a basic block
+
+const unsigned BLOCK_USES_INT_GUARDS = 1;
+const unsigned BLOCK_USES_SEXP_GUARDS = 2;
+
+static unsigned blockGuardUses(BasicBlock *bb, IntGuardsChecker& intGuardsChecker) {
+  unsigned res = 0;
+  
+  for(BasicBlock::iterator ini = bb->begin(), ine = bb->end(); ini != ine; ++ini) {
+    Instruction *in = &*ini;
+    
+    if (StoreInst *st = dyn_cast<StoreInst>(in)) {
+      if (AllocaInst *var = dyn_cast<AllocaInst>(st->getPointerOperand())) {
+        if (intGuardsChecker.isGuard(var)) {
+          res |= BLOCK_USES_INT_GUARDS;
+        }
+        if (isSEXP(var)) {
+          res |= BLOCK_USES_SEXP_GUARDS; // guard, or origins taken from a call (possibly in another block)
+        }
+      }
+      continue;
+    }
+    AllocaInst *vvar;
+    if (CallSite(in) || isVectorOnlyVarOperation(in, vvar)) {
+      res |= BLOCK_USES_SEXP_GUARDS; // the context of a call may depend on the guards
+      continue;
+    }
+  }
+  TerminatorInst *t = bb->getTerminator();
+  if (SwitchInst::classof(t) || (BranchInst::classof(t) && cast<BranchInst>(t)->isConditional())) {
+    res |= BLOCK_USES_INT_GUARDS | BLOCK_USES_SEXP_GUARDS;
+  }
+  if (ReturnInst::classof(t)) {
+    res |= BLOCK_USES_SEXP_GUARDS; // origins of the returned value
+  }
+  return res;
 }
   
 // the hashcode is cached at the time of first hashing
@@ -420,16 +771,30 @@ struct CAllocPackedStateTy_equal {
   }
 };
 
-typedef std::stack<const CAllocPackedStateTy*> WorkListTy;
+typedef StateWorkList<const CAllocPackedStateTy*> WorkListTy;
 typedef std::unordered_set<CAllocPackedStateTy, CAllocPackedStateTy_hash, CAllocPackedStateTy_equal> DoneSetTy;
 
-static WorkListTy workList; // FIXME: avoid these "globals"
-static DoneSetTy doneSet;   // FIXME: avoid these "globals"
+// each thread analyzing called functions has its own states
+
+static thread_local WorkListTy workList;
+static thread_local DoneSetTy doneSet;
+static thread_local size_t doneSetBytes; // approximate memory used by states in the done set
+static StateBudgetTy stateBudget(DEFAULT_MAX_STATES, 0); // per thread, set in computeCalledAllocators
 
-static IntGuardsChecker* intGuardsChecker; // FIXME: avoid these "globals"
-static SEXPGuardsChecker* sexpGuardsChecker; // FIXME: avoid these "globals"
+static thread_local IntGuardsChecker* intGuardsChecker;
+static thread_local SEXPGuardsChecker* sexpGuardsChecker;
 
 
+// measured size of a packed state, including the done set node and bucket
+//   (interned sets of called functions are shared and not included)
+static size_t packedStateBytes(const CAllocPackedStateTy& ps) {
+  size_t res = sizeof(CAllocPackedStateTy) + 3 * sizeof(void*);
+  res += ps.intGuards.fields.bytes() + ps.sexpGuards.fields.bytes();
+  res += ps.sexpGuards.symbols.capacity() * sizeof(SymbolIdTy);
+  res += ps.varOrigins.size() * (sizeof(InternedVarOriginsTy::value_type) + 4 * sizeof(void*)); // map nodes
+  return res;
+}
+
 bool CAllocStateTy::add() {
 
   CAllocPackedStateTy ps = CAllocPackedStateTy::create(*this, *intGuardsChecker, *sexpGuardsChecker);
@@ -437,6 +802,7 @@ bool CAllocStateTy::add() {
   auto sinsert = doneSet.insert(ps);
   if (sinsert.second) {
     const CAllocPackedStateTy* insertedState = &*sinsert.first;
+    doneSetBytes += packedStateBytes(*insertedState);
     workList.push(insertedState); // make the worklist point to the doneset
     return true;
   } else {
@@ -447,13 +813,13 @@ bool CAllocStateTy::add() {
 static void clearStates() { // FIXME: avoid copy paste (vs. bcheck)
   // clear the worklist and the doneset
   doneSet.clear();
-  WorkListTy empty;
-  std::swap(workList, empty);
+  doneSetBytes = 0;
+  workList.clear();
   osTable.clear();
 }
 
 static void getCalledAndWrappedFunctions(const CalledFunctionTy *f, LineMessenger& msg, 
-  CalledFunctionsOrderedSetTy& called, CalledFunctionsOrderedSetTy& wrapped) {
+  CalledFunctionsOrderedSetTy& called, CalledFunctionsOrderedSetTy& wrapped, raw_ostream& err) {
 
   static const CalledFunctionTy* const externalFunctionMarker = new CalledFunctionTy(NULL, NULL, NULL);
   
@@ -462,10 +828,7 @@ static void getCalledAndWrappedFunctions(const CalledFunctionTy *f, LineMessenge
   }
   CalledModuleTy *cm = f->module;
     
-  VarBoolCacheTy sexpGuardVarsCache;
-
-  BasicBlocksSetTy errorBasicBlocks;
-  findErrorBasicBlocks(f->fun, cm->getErrorFunctions(), errorBasicBlocks); // FIXME: this could be remembered in CalledFunction
+  const BasicBlocksSetTy& errorBasicBlocks = getModuleAnalyses(cm->getModule())->getErrorBasicBlocks(f->fun);
     
   VarsSetTy possiblyReturnedVars; 
   findPossiblyReturnedVariables(f->fun, possiblyReturnedVars); // to restrict origin tracking
@@ -489,10 +852,12 @@ static void getCalledAndWrappedFunctions(const CalledFunctionTy *f, LineMessenge
   }
     
   clearStates();
+  workList.setFunction(f->fun);
   
   msg.newFunction(f->fun, " - " + funName(f));
-  intGuardsChecker = new IntGuardsChecker(&msg);
-  sexpGuardsChecker = new SEXPGuardsChecker(&msg, cm->getGlobals(), NULL /* possible allocators */, cm->getSymbolsMap(), f->argInfo, cm->getVrfState(), cm);
+  const FunctionVarsTy* vars = getModuleAnalyses(f->fun->getParent())->getFunctionVars(f->fun, cm->getGlobals()); // shared by all contexts
+  intGuardsChecker = new IntGuardsChecker(&msg, vars);
+  sexpGuardsChecker = new SEXPGuardsChecker(&msg, vars, cm->getGlobals(), NULL /* possible allocators */, cm->getSymbolsMap(), f->argInfo, cm->getVrfState(), cm);
   
   bool intGuardsEnabled = !avoidIntGuardsFor(f);
   bool sexpGuardsEnabled = !avoidSEXPGuardsFor(f);
@@ -501,12 +866,28 @@ static void getCalledAndWrappedFunctions(const CalledFunctionTy *f, LineMessenge
     CAllocStateTy* initState = new CAllocStateTy(&f->fun->getEntryBlock());
     initState->add();
   }
+  TimePointTy start = timeNow();
+  
+  std::unordered_map<BasicBlock*, unsigned> guardUses; // per block
   
   while(!workList.empty()) {
-    CAllocStateTy s(*workList.top(), *intGuardsChecker, *sexpGuardsChecker); // unpacks the state
-    workList.pop();    
+    CAllocStateTy s(workList.top()); // unpacked lazily
+    workList.pop();
+    
+    auto usearch = guardUses.find(s.bb);
+    if (usearch == guardUses.end()) {
+      usearch = guardUses.insert({s.bb, blockGuardUses(s.bb, *intGuardsChecker)}).first;
+    }
+    if ((usearch->second & BLOCK_USES_INT_GUARDS) && intGuardsEnabled) {
+      s.unpackIntGuards(*intGuardsChecker);
+    }
+    if (usearch->second & BLOCK_USES_SEXP_GUARDS) {
+      s.unpackSEXPGuards(*sexpGuardsChecker);
+    }
 
     if (DUMP_STATES && (DUMP_STATES_FUNCTION.empty() || DUMP_STATES_FUNCTION == f->getName())) {
+      s.unpackIntGuards(*intGuardsChecker);
+      s.unpackSEXPGuards(*sexpGuardsChecker);
       msg.trace("going to work on this state:", &*s.bb->begin());
       s.dump("worklist top");
     }    
@@ -520,8 +901,9 @@ static void getCalledAndWrappedFunctions(const CalledFunctionTy *f, LineMessenge
       continue;
     }
       
-    if (doneSet.size() > MAX_STATES) {
-      errs() << "ERROR: too many states (abstraction error?) in function " << funName(f) << "\n";
+    bool tooManyStates = stateBudget.exceeded(doneSet.size(), doneSetBytes);
+    if (tooManyStates || stateBudget.timeExceeded(start)) {
+      err << "ERROR: " << (tooManyStates ? "too many states" : "too much time") << " (abstraction error?) in function " << funName(f) << "\n";
       clearStates();
       delete intGuardsChecker;
       delete sexpGuardsChecker;
@@ -603,7 +985,9 @@ static void getCalledAndWrappedFunctions(const CalledFunctionTy *f, LineMessenge
             
             // FIXME: should also handle phi nodes here, currently we may miss some allocators
             if (msg.debug()) msg.debug("dropping origins of " + varName(dst) + " at variable overwrite", in);
-            s.varOrigins.erase(dst);
+            if (s.varOrigins().count(dst)) {
+              s.modifiedVarOrigins().erase(dst);
+            }
             
             ValuesSetTy vorig = valueOrigins(st->getValueOperand()); // this goes through Phi's and macros like CDR, CAR etc
             for(ValuesSetTy::iterator vi = vorig.begin(), ve = vorig.end(); vi != ve; ++vi) { 
@@ -621,10 +1005,10 @@ static void getCalledAndWrappedFunctions(const CalledFunctionTy *f, LineMessenge
                 if (isSEXP(src)) {
                   // copy all var origins of src into dst
                   if (msg.debug()) msg.debug("propagating origins on assignment of " + varName(src) + " to " + varName(dst), in); 
-                  auto sorig = s.varOrigins.find(src);
-                  if (sorig != s.varOrigins.end()) {
-                    CalledFunctionsOrderedSetTy& srcOrigs = sorig->second;
-                    s.varOrigins.insert({dst, srcOrigs}); // set (copy) origins
+                  auto sorig = s.varOrigins().find(src);
+                  if (sorig != s.varOrigins().end()) {
+                    const CalledFunctionsOrderedSetTy* srcOrigs = sorig->second;
+                    s.modifiedVarOrigins().insert({dst, srcOrigs}); // set (share) origins
                   }
                   continue;
                 }
@@ -647,7 +1031,7 @@ static void getCalledAndWrappedFunctions(const CalledFunctionTy *f, LineMessenge
                 if (msg.debug()) msg.debug("setting origin " + funName(tgt) + " of " + varName(dst), in); 
                 CalledFunctionsOrderedSetTy newOrigins;
                 newOrigins.insert(tgt);
-                s.varOrigins.insert({dst, newOrigins});
+                s.modifiedVarOrigins().insert({dst, osTable.intern(newOrigins)});
                 continue;
               }
             }
@@ -698,18 +1082,18 @@ static void getCalledAndWrappedFunctions(const CalledFunctionTy *f, LineMessenge
 
           if (AllocaInst *src = dyn_cast<AllocaInst>(v)) {
             if (isSEXP(src)) {
-              auto origins = s.varOrigins.find(src);
+              auto origins = s.varOrigins().find(src);
               size_t nOrigins = 0;
-              if (origins != s.varOrigins.end()) {
-                CalledFunctionsOrderedSetTy& knownOrigins = origins->second;
+              if (origins != s.varOrigins().end()) {
+                const CalledFunctionsOrderedSetTy& knownOrigins = *origins->second;
                 wrapped.insert(knownOrigins.begin(), knownOrigins.end()); // copy origins as result
                 nOrigins = knownOrigins.size();
               }
               if (msg.debug()) msg.debug("collecting " + std::to_string(nOrigins) + " at function return, variable " + varName(src), t);
-              if (msg.debug() && origins != s.varOrigins.end()) {
+              if (msg.debug() && origins != s.varOrigins().end()) {
                 std::string tmp = "tracked origins included:";
-                CalledFunctionsOrderedSetTy& knownOrigins = origins->second;
-                for(CalledFunctionsOrderedSetTy::iterator oi = knownOrigins.begin(), oe = knownOrigins.end(); oi != oe; ++oi) {
+                const CalledFunctionsOrderedSetTy& knownOrigins = *origins->second;
+                for(CalledFunctionsOrderedSetTy::const_iterator oi = knownOrigins.begin(), oe = knownOrigins.end(); oi != oe; ++oi) {
                   const CalledFunctionTy* cf = *oi;
                   tmp += " ";
                   tmp += funName(cf);
@@ -774,51 +1158,90 @@ static void getCalledAndWrappedFunctions(const CalledFunctionTy *f, LineMessenge
   }
 }
 
-typedef std::vector<std::vector<bool>> BoolMatrixTy;
+// result of analyzing a single called function
+struct CalledFunctionResultTy {
+  CalledFunctionsOrderedSetTy called;
+  CalledFunctionsOrderedSetTy wrapped;
+  std::string out; // messages (printed in the order of functions, not threads)
+  std::string err;
+  bool analyzed;
+  
+  CalledFunctionResultTy(): analyzed(false) {}
+};
+
+// deterministic order of called functions (for indexing)
+struct CalledFunctionTy_less {
+  bool operator() (const CalledFunctionTy& lhs, const CalledFunctionTy& rhs) const {
+    int cmp = lhs.fun->getName().compare(rhs.fun->getName());
+    if (cmp != 0) {
+      return cmp < 0;
+    }
+    if (lhs.argInfo->size() != rhs.argInfo->size()) {
+      return lhs.argInfo->size() < rhs.argInfo->size();
+    }
+    return lhs.getNameSuffix() < rhs.getNameSuffix();
+  }
+};
+
 typedef std::vector<unsigned> AdjacencyListRow;
 typedef std::vector<AdjacencyListRow> AdjacencyListTy;
 
 static void resize(AdjacencyListTy& list, unsigned n) {
-  list.resize(n);
+  if (list.size() < n) {
+    list.resize(n);
+  }
 }
 
-static void resize(BoolMatrixTy& matrix, unsigned n) {
-  unsigned oldn = matrix.size();
-  if (n <= oldn) {
-    return;
-  }
-  matrix.resize(n);
-  for (unsigned i = 0; i < n; i++) {
-    matrix[i].resize(n);
+// find which functions reach the target (through at least one edge) in a
+// graph given by the reverse edges (list[j] has the functions with an edge to j)
+//   only the reachability of the GC function is needed, so a single reverse
+//   search replaces computing the transitive closure
+
+static void findReaching(AdjacencyListTy& reverseList, unsigned target, std::vector<bool>& reaching) {
+
+  reaching.assign(reverseList.size(), false);
+  std::vector<unsigned> workList;
+  workList.push_back(target);
+  while(!workList.empty()) {
+    unsigned j = workList.back();
+    workList.pop_back();
+    for(AdjacencyListRow::iterator ii = reverseList[j].begin(), ie = reverseList[j].end(); ii != ie; ++ii) {
+      unsigned i = *ii;
+      if (!reaching[i]) {
+        reaching[i] = true;
+        workList.push_back(i);
+      }
+    }
   }
 }
 
-static void buildClosure(BoolMatrixTy& mat, AdjacencyListTy& list, unsigned n) {
+// takes the called and wrapped functions of a base function from the snapshot
+bool CalledModuleTy::getSnapshotResult(const CalledFunctionTy* f, CalledFunctionsOrderedSetTy& called, CalledFunctionsOrderedSetTy& wrapped) {
 
-  bool added = true;
-  while(added) {
-    added = false;
-    
-    for(unsigned i = 0; i < n; i++) {
-      for(unsigned jidx = 0; jidx < list[i].size(); jidx++) {
-        unsigned j = list[i][jidx];
-        if (i == j) {
-          continue;
-        }
-        for(unsigned kidx = 0; kidx < list[j].size(); kidx++) {
-          unsigned k = list[j][kidx];
-          if (j == k) {
-            continue;
-          }
-          if (!mat[i][k]) {
-            mat[i][k] = true;
-            list[i].push_back(k);
-            added = true;
-          }
-        }
-      }
+  const BaseSnapshotTy* snapshot = getBaseSnapshot();
+  if (!snapshot || !snapshot->isBaseFunction(f->fun)) {
+    return false;
+  }
+  auto ssearch = snapshot->calledFunctions.find(getKey(f));
+  if (ssearch == snapshot->calledFunctions.end()) {
+    return false; // a context not seen in the base alone
+  }
+  const SnapshotCalledFunctionTy& r = ssearch->second;
+  for(CalledFunctionKeysTy::const_iterator ki = r.called.begin(), ke = r.called.end(); ki != ke; ++ki) {
+    const CalledFunctionTy *cf = getCalledFunction(*ki);
+    if (!cf) {
+      return false;
     }
+    called.insert(cf);
   }
+  for(CalledFunctionKeysTy::const_iterator ki = r.wrapped.begin(), ke = r.wrapped.end(); ki != ke; ++ki) {
+    const CalledFunctionTy *wf = getCalledFunction(*ki);
+    if (!wf) {
+      return false;
+    }
+    wrapped.insert(wf);
+  }
+  return true;
 }
 
 void CalledModuleTy::computeCalledAllocators() {
@@ -836,76 +1259,149 @@ void CalledModuleTy::computeCalledAllocators() {
   
   possibleCAllocators = new CalledFunctionsSetTy();
   allocatingCFunctions = new CalledFunctionsSetTy();
-  
-  LineMessenger msg(m->getContext(), DEBUG, TRACE, UNIQUE_MSG);
+  unsigned nJobs = getJobs();
+  stateBudget = getStateBudget(DEFAULT_MAX_STATES, nJobs);
+  computeVectorReturningFunctions(); // otherwise computed lazily by the first analysis
   
   unsigned nfuncs = getNumberOfCalledFunctions(); // NOTE: nfuncs can increase during the checking
 
-  BoolMatrixTy callsMat(nfuncs, std::vector<bool>(nfuncs));  // calls[i][j] - function i calls function j
-  AdjacencyListTy callsList(nfuncs, AdjacencyListRow()); // calls[i] - list of functions called by i
-  BoolMatrixTy wrapsMat(nfuncs, std::vector<bool>(nfuncs));  // wraps[i][j] - function i wraps function j
-  AdjacencyListTy wrapsList(nfuncs, AdjacencyListRow()); // wraps[i] - list of functions wrapped by i
+  AdjacencyListTy callersList(nfuncs, AdjacencyListRow()); // callers[j] - list of functions calling j
+  AdjacencyListTy wrappersList(nfuncs, AdjacencyListRow()); // wrappers[j] - list of functions wrapping j
   
-  for(unsigned i = 0; i < getNumberOfCalledFunctions(); i++) {
-
-    const CalledFunctionTy *f = getCalledFunction(i);
-    if (!f->fun || !f->fun->size() || !isAllocating(f->fun)) {
-      continue;
-    }
-    
-    CalledFunctionsOrderedSetTy called;
-    CalledFunctionsOrderedSetTy wrapped;
-    getCalledAndWrappedFunctions(f, msg, called, wrapped);
+  // the called functions are analyzed in rounds, each round analyzes
+  // concurrently the functions known at its start; called functions
+  // discovered during a round are indexed at its end, so that the indexes
+  // do not depend on the order in which the threads discover them
+  
+  for(unsigned first = 0; first < getNumberOfCalledFunctions();) {
+  
+    unsigned last = getNumberOfCalledFunctions();
+    std::vector<CalledFunctionResultTy> results(last - first);
+    std::atomic<unsigned> next(first);
     
-    if (DEBUG && called.size()) {
-      errs() << "\nDetected (possible allocators) called by function " << funName(f) << ":\n";
-      for(CalledFunctionsOrderedSetTy::const_iterator cfi = called.begin(), cfe = called.end(); cfi != cfe; ++cfi) {
-        const CalledFunctionTy *cf = *cfi;
-        errs() << "   " << funName(cf) << "\n";
+    auto worker = [&]() {
+      for(;;) {
+        unsigned i = next++;
+        if (i >= last) {
+          break;
+        }
+        const CalledFunctionTy *f = getCalledFunction(i);
+        if (!f->fun || !f->fun->size() || !isAllocating(f->fun)) {
+          continue;
+        }
+        CalledFunctionResultTy& r = results[i - first];
+        r.analyzed = true;
+        if (getSnapshotResult(f, r.called, r.wrapped)) {
+          continue;
+        }
+        r.called.clear();
+        r.wrapped.clear();
+        raw_string_ostream outStream(r.out);
+        raw_string_ostream errStream(r.err);
+        LineMessenger msg(m->getContext(), DEBUG, TRACE, UNIQUE_MSG, outStream);
+        getCalledAndWrappedFunctions(f, msg, r.called, r.wrapped, errStream);
+        msg.flush();
+        outStream.flush();
+        errStream.flush();
       }
+    };
+    
+    {
+      std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
+      calledFunctionsTable.deferIndexing();
     }
-    if (DEBUG && wrapped.size()) {
-      errs() << "\nDetected (possible allocators) wrapped by function " << funName(f) << ":\n";
-      for(CalledFunctionsOrderedSetTy::const_iterator cfi = wrapped.begin(), cfe = wrapped.end(); cfi != cfe; ++cfi) {
-        const CalledFunctionTy *cf = *cfi;
-        errs() << "   " << funName(cf) << "\n";
+    unsigned nThreads = std::min(nJobs, last - first);
+    if (nThreads > 1) {
+      std::vector<std::thread> threads;
+      for(unsigned j = 0; j < nThreads; j++) {
+        threads.push_back(std::thread(worker));
       }
-    }
-    if (DEBUG) {
-      FunctionsSetTy wrappedAllocators;
-      getWrappedAllocators(f->fun, wrappedAllocators, getGCFunction(m));
-      if (!wrappedAllocators.empty()) {
-        errs() << "\nSimple (possible allocators) wrapped by function " << funName(f) << ":\n";
-        for(FunctionsSetTy::iterator fi = wrappedAllocators.begin(), fe = wrappedAllocators.end(); fi != fe; ++fi) {
-          Function *sf = *fi;
-          errs() << "   " << funName(sf) << "\n";
-        }
+      for(std::vector<std::thread>::iterator ti = threads.begin(), te = threads.end(); ti != te; ++ti) {
+        ti->join();
       }
+    } else {
+      worker();
     }
+    calledFunctionsTable.indexDeferred(CalledFunctionTy_less());
     
     nfuncs = getNumberOfCalledFunctions(); // get the current size
-    resize(callsList, nfuncs);
-    resize(wrapsList, nfuncs);
-    resize(callsMat, nfuncs);
-    resize(wrapsMat, nfuncs);
+    resize(callersList, nfuncs);
+    resize(wrappersList, nfuncs);
+
+    for(unsigned i = first; i < last; i++) {
+      const CalledFunctionTy *f = getCalledFunction(i);
+      CalledFunctionResultTy& r = results[i - first];
+      CalledFunctionsOrderedSetTy& called = r.called;
+      CalledFunctionsOrderedSetTy& wrapped = r.wrapped;
+      
+      if (!r.out.empty()) {
+        outs() << r.out;
+      }
+      if (!r.err.empty()) {
+        errs() << r.err;
+      }
+      if (DEBUG && called.size()) {
+        errs() << "\nDetected (possible allocators) called by function " << funName(f) << ":\n";
+        for(CalledFunctionsOrderedSetTy::const_iterator cfi = called.begin(), cfe = called.end(); cfi != cfe; ++cfi) {
+          const CalledFunctionTy *cf = *cfi;
+          errs() << "   " << funName(cf) << "\n";
+        }
+      }
+      if (DEBUG && wrapped.size()) {
+        errs() << "\nDetected (possible allocators) wrapped by function " << funName(f) << ":\n";
+        for(CalledFunctionsOrderedSetTy::const_iterator cfi = wrapped.begin(), cfe = wrapped.end(); cfi != cfe; ++cfi) {
+          const CalledFunctionTy *cf = *cfi;
+          errs() << "   " << funName(cf) << "\n";
+        }
+      }
+      if (DEBUG && f->fun && f->fun->size() && isAllocating(f->fun)) {
+        FunctionsSetTy wrappedAllocators;
+        getWrappedAllocators(f->fun, wrappedAllocators, getGCFunction(m));
+        if (!wrappedAllocators.empty()) {
+          errs() << "\nSimple (possible allocators) wrapped by function " << funName(f) << ":\n";
+          for(FunctionsSetTy::iterator fi = wrappedAllocators.begin(), fe = wrappedAllocators.end(); fi != fe; ++fi) {
+            Function *sf = *fi;
+            errs() << "   " << funName(sf) << "\n";
+          }
+        }
+      }
     
-    for(CalledFunctionsOrderedSetTy::const_iterator cfi = called.begin(), cfe = called.end(); cfi != cfe; ++cfi) {
-      const CalledFunctionTy *cf = *cfi;
-      callsMat[f->idx][cf->idx] = true;
-      callsList[f->idx].push_back(cf->idx);
-    }
+      if (recordedSnapshot && r.analyzed) {
+        SnapshotCalledFunctionTy& sr = recordedSnapshot->calledFunctions[getKey(f)];
+        for(CalledFunctionsOrderedSetTy::const_iterator cfi = called.begin(), cfe = called.end(); cfi != cfe; ++cfi) {
+          sr.called.push_back(getKey(*cfi));
+        }
+        for(CalledFunctionsOrderedSetTy::const_iterator wfi = wrapped.begin(), wfe = wrapped.end(); wfi != wfe; ++wfi) {
+          sr.wrapped.push_back(getKey(*wfi));
+        }
+      }
+    
+      for(CalledFunctionsOrderedSetTy::const_iterator cfi = called.begin(), cfe = called.end(); cfi != cfe; ++cfi) {
+        const CalledFunctionTy *cf = *cfi;
+        callersList[cf->idx].push_back(f->idx);
+        if (roots && cf->hasContext()) {
+          getCalledFunction(cf->fun); // make sure each reachable function has a called function counterpart
+        }
+      }
 
-    for(CalledFunctionsOrderedSetTy::const_iterator wfi = wrapped.begin(), wfe = wrapped.end(); wfi != wfe; ++wfi) {
-      const CalledFunctionTy *wf = *wfi;
-      wrapsMat[f->idx][wf->idx] = true;
-      wrapsList[f->idx].push_back(wf->idx);
-    }    
+      for(CalledFunctionsOrderedSetTy::const_iterator wfi = wrapped.begin(), wfe = wrapped.end(); wfi != wfe; ++wfi) {
+        const CalledFunctionTy *wf = *wfi;
+        wrappersList[wf->idx].push_back(f->idx);
+        if (roots && wf->hasContext()) {
+          getCalledFunction(wf->fun);
+        }
+      }
+    }
+    first = last;
   }
   
-  // calculate transitive closure
+  // find functions (transitively) calling and wrapping the GC function
 
-  buildClosure(callsMat, callsList, nfuncs);
-  buildClosure(wrapsMat, wrapsList, nfuncs);
+  unsigned gcidx = gcFunction->idx;
+  std::vector<bool> callsGC;
+  std::vector<bool> wrapsGC;
+  findReaching(callersList, gcidx, callsGC);
+  findReaching(wrappersList, gcidx, wrapsGC);
   
   // fill in results
   
@@ -915,16 +1411,15 @@ void CalledModuleTy::computeCalledAllocators() {
   contextSensitiveAllocatingFunctions = new FunctionsSetTy();
   contextSensitivePossibleAllocators = new FunctionsSetTy();
   
-  unsigned gcidx = gcFunction->idx;
   for(unsigned i = 0; i < nfuncs; i++) {
-    if (callsMat[i][gcidx]) {
+    if (callsGC[i]) {
       const CalledFunctionTy *tgt = getCalledFunction(i);
       allocatingCFunctions->insert(tgt);
       if (!tgt->hasContext()) {
         contextSensitiveAllocatingFunctions->insert(tgt->fun);
       }
     }
-    if (wrapsMat[i][gcidx]) {
+    if (wrapsGC[i]) {
       const CalledFunctionTy *tgt = getCalledFunction(i);
       if (!isKnownNonAllocator(tgt)) {
         possibleCAllocators->insert(tgt);
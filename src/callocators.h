@@ -7,10 +7,14 @@ class CalledModuleTy;
 #include "common.h"
 #include "allocators.h"
 #include "guards.h"
+#include "hashed.h"
+#include "region.h"
+#include "snapshot.h"
 #include "symbols.h"
 #include "table.h"
 #include "vectors.h"
 
+#include <shared_mutex>
 #include <unordered_set>
 #include <vector>
 
@@ -32,28 +36,23 @@ struct ArgInfoTy {
 
 struct SymbolArgInfoTy : public ArgInfoTy {
 
-  const std::string symbolName;
-  SymbolArgInfoTy(const std::string& symbolName) : symbolName(symbolName) {};
+  const SymbolIdTy symbol;
+  SymbolArgInfoTy(SymbolIdTy symbol) : symbol(symbol) {};
   
   virtual bool isSymbol() const { return true; }
-  
-  struct SymbolArgInfoTy_hash {
-    size_t operator()(const SymbolArgInfoTy& t) const {
-      return std::hash<std::string>()(t.symbolName);
-    }
-  };
-
-  struct SymbolArgInfoTy_equal {
-    bool operator() (const SymbolArgInfoTy& lhs, const SymbolArgInfoTy& rhs) const {
-      return lhs.symbolName == rhs.symbolName;
-    }
-  };
+  const std::string& getSymbolName() const { return ::getSymbolName(symbol); }
 
-  typedef InterningTable<SymbolArgInfoTy, SymbolArgInfoTy_hash, SymbolArgInfoTy_equal> SymbolArgInfoTableTy;
+  typedef std::vector<const SymbolArgInfoTy*> SymbolArgInfoTableTy; // indexed by symbol id
   static SymbolArgInfoTableTy table;
   
-  static const SymbolArgInfoTy* create(const std::string& symbolName) {
-    return table.intern(SymbolArgInfoTy(symbolName)); // FIXME: leaks memory  
+  static const SymbolArgInfoTy* create(SymbolIdTy symbol) { // one per symbol, never freed
+    if (symbol >= table.size()) {
+      table.resize(symbol + 1, NULL);
+    }
+    if (!table[symbol]) {
+      table[symbol] = new SymbolArgInfoTy(symbol);
+    }
+    return table[symbol];
   }
 };
 
@@ -118,10 +117,32 @@ typedef InterningTable<ArgInfosVectorTy, ArgInfosVectorTy_hash> ArgInfoVectorsTa
   // yikes, need forward type def
 struct SEXPGuardTy;
 class SEXPGuardsChecker;
-typedef std::map<AllocaInst*,SEXPGuardTy> SEXPGuardsTy;
+struct SEXPGuardTy_entryHash;
+typedef HashedMap<AllocaInst*,SEXPGuardTy,SEXPGuardTy_entryHash,RegionAllocator<std::pair<AllocaInst* const,SEXPGuardTy>>> SEXPGuardsTy;
 
 typedef std::map<Value*, CalledFunctionsSetTy> CallSiteTargetsTy;
 
+// memoized called functions of a call site, for the guard states of the
+// variables which may influence the context
+
+struct CallSiteGuardTy {
+  unsigned state; // SEXPGuardState
+  SymbolIdTy symbol;
+};
+
+struct CallSiteContextTy {
+  bool withGuards;
+  std::vector<CallSiteGuardTy> guards; // states of CallSiteCacheTy::vars
+  const CalledFunctionTy* calledFunction;
+};
+
+struct CallSiteCacheTy {
+  std::vector<AllocaInst*> vars; // variables the context of the call may depend on
+  std::vector<CallSiteContextTy> contexts;
+};
+
+typedef std::unordered_map<Value*, CallSiteCacheTy> CallSiteCachesTy;
+
 class CalledModuleTy {
   CalledFunctionsTableTy calledFunctionsTable; // intern table
   ArgInfoVectorsTableTy argInfoVectorsTable; // intern table
@@ -138,6 +159,11 @@ class CalledModuleTy {
   CalledFunctionsSetTy* allocatingCFunctions;
   CallSiteTargetsTy callSiteTargets; // maps  call instruction -> set of target functions
   VrfStateTy* vrfState; // state for vector returning functions detection
+  BaseSnapshotTy* recordedSnapshot; // when not NULL, results of called functions analysis are recorded here
+  const FunctionsOrderedSetTy* roots; // when not NULL, only called functions reachable from these are analyzed
+  std::unordered_map<Function*, std::vector<bool>> relevantArgs; // arguments that can influence the analysis of a function
+  CallSiteCachesTy callSiteCaches;
+  std::shared_timed_mutex callSiteCachesLock; // for callSiteCaches and callSiteTargets: shared for lookups, exclusive for updates (also under sharedStateLock)
   
   const CalledFunctionTy* const gcFunction;
 
@@ -145,18 +171,30 @@ class CalledModuleTy {
     const ArgInfosVectorTy* intern(const ArgInfosVectorTy& argInfos) { return argInfoVectorsTable.intern(argInfos); }
     const CalledFunctionTy* intern(const CalledFunctionTy& calledFunction) { return calledFunctionsTable.intern(calledFunction); }
     void computeCalledAllocators();
+    const std::vector<bool>& getRelevantArgs(Function *f);
+    void findContextVars(Value *inst, std::vector<AllocaInst*>& vars, bool nested);
+    void computeArgInfo(CallSite& cs, SEXPGuardsChecker *sexpGuardsChecker, SEXPGuardsTy *sexpGuards, ArgInfosVectorTy& argInfo, bool onlyRelevant);
+    const CalledFunctionTy* computeCalledFunction(CallSite& cs, SEXPGuardsChecker *sexpGuardsChecker, SEXPGuardsTy *sexpGuards);
+    const CalledFunctionTy* findCachedCalledFunction(Value *inst, SEXPGuardsTy *sexpGuards, bool registerCallSite);
+    bool getSnapshotResult(const CalledFunctionTy* f, CalledFunctionsOrderedSetTy& called, CalledFunctionsOrderedSetTy& wrapped);
 
   public:
+    // with roots, the module is demand-driven: context-sensitive allocators
+    // and vector-returning functions are only computed for the called
+    // functions (transitively) reachable from the roots
     CalledModuleTy(Module *m, SymbolsMapTy* symbolsMap, FunctionsSetTy* errorFunctions, GlobalsTy* globals,
-      FunctionsSetTy* possibleAllocators, FunctionsSetTy* allocatingFunctions);
+      FunctionsSetTy* possibleAllocators, FunctionsSetTy* allocatingFunctions, const FunctionsOrderedSetTy* roots = NULL);
       
-    static CalledModuleTy* create(Module *m);
+    static CalledModuleTy* create(Module *m, const FunctionsOrderedSetTy* roots = NULL);
     static void release(CalledModuleTy *cm);
       
     const CalledFunctionTy* getCalledFunction(Value *inst, bool registerCallSite = false);
     const CalledFunctionTy* getCalledFunction(Value *inst, SEXPGuardsChecker *sexpGuardsChecker, SEXPGuardsTy *sexpGuards, bool registerCallSite); // takes context from guards
     const CalledFunctionTy* getCalledFunction(Function *f); // gets a version with no context
+    std::string getCallName(Value *inst, SEXPGuardsChecker *sexpGuardsChecker, SEXPGuardsTy *sexpGuards); // for messages, lists all known arguments, also collapsed ones
     const CalledFunctionTy* getCalledFunction(unsigned idx) { return calledFunctionsTable.at(idx); };
+    const CalledFunctionTy* getCalledFunction(const CalledFunctionKeyTy& key); // NULL when not in the module
+    CalledFunctionKeyTy getKey(const CalledFunctionTy* cf);
     const CalledFunctionsIndexTy* getCalledFunctions() { return calledFunctionsTable.getIndex(); }
     size_t getNumberOfCalledFunctions() { return calledFunctionsTable.getIndex()->size(); }
     const CalledFunctionsSetTy* getPossibleCAllocators() { computeCalledAllocators(); return possibleCAllocators; }
@@ -182,6 +220,8 @@ class CalledModuleTy {
     void computeVectorReturningFunctions() { if (vrfState == NULL) findVectorReturningFunctions(this); }
     VrfStateTy* getVrfState() { computeVectorReturningFunctions(); return vrfState; }
     void setVrfState(VrfStateTy* vrfState) { this->vrfState = vrfState; }
+    bool isDemandDriven() { return roots != NULL; }
+    void recordSnapshot(BaseSnapshotTy* snapshot) { recordedSnapshot = snapshot; }
 };
 
 std::string funName(const CalledFunctionTy *cf);
@@ -13,6 +13,7 @@
 
 #include "allocators.h"
 #include "cgclosure.h"
+#include "tools.h"
 
 using namespace llvm;
 
@@ -29,25 +30,19 @@ void getCalledFunctions(Function *f, FunctionsSetTy& calledFunctions) {
   }
 }
 
-int main(int argc, char* argv[])
-{
-  LLVMContext context;
-  FunctionsOrderedSetTy functionsOfInterestSet;
-  FunctionsVectorTy functionsOfInterestVector;
-  
-  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);
+static int runCgcheck(Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
 
   /* ignore Rf_error because it calls into Rf_errorcall */
   Function *errorf = m->getFunction("Rf_error");
   if (!errorf) {
     errs() << "Cannot find function to check.\n";
-    exit(1);
+    return 1;
   }
 
   Function *myf = m->getFunction("Rf_errorcall");
   if (!myf) {
     errs() << "Cannot find function to check.\n";
-    exit(1);
+    return 1;
   }
   
   FunctionsSetTy onlyFunctions;
@@ -65,20 +60,18 @@ int main(int argc, char* argv[])
   }
 
   FunctionsInfoMapTy functionsMap;
-  buildCGClosure(m, functionsMap, false /* ignore error paths */, &onlyFunctions, &onlyEdges);
+  buildCG(m, functionsMap, false /* ignore error paths */, &onlyFunctions, &onlyEdges);
   
   for(CallEdgesMapTy::iterator cei = onlyEdges.begin(), cee = onlyEdges.end(); cei != cee; ++cei) {
     delete cei->second;
   }
 
-  unsigned myfindex = 0;
-  
   auto fsearch = functionsMap.find(myf);
   if (fsearch == functionsMap.end()) {
     errs() << "Cannot find function info of function to check\n";
-    exit(1);
+    return 1;
   }
-  myfindex = fsearch->second.index;  
+  FunctionsBitsTy myfCallers = findCallersOf(functionsMap, {&fsearch->second});
 
   errs() << "Functions calling (recursively) function " << funName(myf) << "\n";
   for(FunctionsVectorTy::iterator FI = functionsOfInterestVector.begin(), FE = functionsOfInterestVector.end(); FI != FE; ++FI) {
@@ -87,10 +80,19 @@ int main(int argc, char* argv[])
     if (fisearch == functionsMap.end()) continue;
     FunctionInfo& finfo = fisearch->second;
 
-    if ((finfo.callsFunctionMap)[myfindex]) {
+    if (myfCallers[finfo.index]) {
       errs() << funName(finfo.function) << "\n";
     }
   }
 
-  delete m;
+  return 0;
+}
+
+const ToolTy cgcheckTool = { "cgcheck", NULL, runCgcheck };
+
+#ifndef RCHK_DRIVER
+int main(int argc, char* argv[])
+{
+  return runTool(argc, argv, cgcheckTool);
 }
+#endif
@@ -1,6 +1,8 @@
 
 #include "cgclosure.h"
-#include "errors.h"
+#include "analyses.h"
+
+#include <memory>
 
 #include <llvm/Analysis/CallGraph.h>
 
@@ -10,18 +12,13 @@ using namespace llvm;
 
 const bool DEBUG = false;
 
-// build closure over the callgraph of module m
+// build the callgraph of module m
 // each function from module m gets its FunctionInfo in the functionsMap
 
-void buildCGClosure(Module *m, FunctionsInfoMapTy& functionsMap, bool ignoreErrorPaths, FunctionsSetTy *onlyFunctions, CallEdgesMapTy *onlyEdges, Function* externalFunction) {
-
-  FunctionsSetTy errorFunctions;
-  if (ignoreErrorPaths) {
-    findErrorFunctions(m, errorFunctions);
-  }
+void buildCG(Module *m, FunctionsInfoMapTy& functionsMap, bool ignoreErrorPaths, FunctionsSetTy *onlyFunctions, CallEdgesMapTy *onlyEdges, Function* externalFunction) {
 
-  // build llvm callgraph
-  CallGraph *cg = new CallGraph(*m);
+  ModuleAnalysesTy *analyses = getModuleAnalyses(m);
+  CallGraph *cg = analyses->getCallGraph();
   
   // convert the callgraph to a different structure, suitable for transitive closure computation
   //
@@ -31,19 +28,6 @@ void buildCGClosure(Module *m, FunctionsInfoMapTy& functionsMap, bool ignoreErro
   unsigned long edges = 0;
   unsigned long functions = 0;
   
-  // count (maximum) number of functions that will be stored in calledFunctionsMap (also a bound for function index)
-  unsigned long maxFunctions = 0;
-  
-  for (CallGraph::const_iterator MI = cg->begin(), ME = cg->end(); MI != ME; ++MI) {
-    Function* fun = const_cast<Function*>(MI->first);
-    if (!fun) continue;
-    
-    if (onlyFunctions && onlyFunctions->find(fun) == onlyFunctions->end()) {
-      continue;
-    }
-    maxFunctions++;
-  }
-     
   for (CallGraph::const_iterator MI = cg->begin(), ME = cg->end(); MI != ME; ++MI) {
     Function* fun = const_cast<Function*>(MI->first);
     const CallGraphNode* sourceCGN = MI->second.get();
@@ -56,21 +40,23 @@ void buildCGClosure(Module *m, FunctionsInfoMapTy& functionsMap, bool ignoreErro
     FunctionInfo *finfo;
     auto fsearch = functionsMap.find(fun);
     if (fsearch == functionsMap.end()) {
-      auto insert = functionsMap.insert({fun, FunctionInfo(fun, functions++, maxFunctions)});
+      auto insert = functionsMap.insert({fun, FunctionInfo(fun, functions++)});
       finfo = &insert.first->second;
     } else {
       finfo = &fsearch->second;
     }
     
+    if (onlyEdges && onlyEdges->find(fun) == onlyEdges->end()) {
+      continue; // no edges from this function
+    }
+    
     // check which basic blocks of the function are "error" blocks
     //  (they always end up, possibly recursively, in a noreturn - that is error - function)
     //  recursively means through other basic blocks of the same function, but we won't catch
     //  if a noreturn function is wrapped
     
-    BasicBlocksSetTy errorBlocks;
-    if (ignoreErrorPaths) {
-      findErrorBasicBlocks(fun, &errorFunctions, errorBlocks);
-    }
+    static const BasicBlocksSetTy noErrorBlocks;
+    const BasicBlocksSetTy& errorBlocks = ignoreErrorPaths ? analyses->getErrorBasicBlocks(fun) : noErrorBlocks;
 
     for(CallGraphNode::const_iterator RI = sourceCGN->begin(), RE = sourceCGN->end(); RI != RE; ++RI) {
       const CallGraphNode::CallRecord *cr = &*RI;
@@ -111,7 +97,7 @@ void buildCGClosure(Module *m, FunctionsInfoMapTy& functionsMap, bool ignoreErro
       auto search = functionsMap.find(targetFun);
       if (search == functionsMap.end()) {
         if (DEBUG) errs() << " creating new info";
-        auto insert = functionsMap.insert({targetFun, FunctionInfo(targetFun, functions++, maxFunctions)});
+        auto insert = functionsMap.insert({targetFun, FunctionInfo(targetFun, functions++)});
         targetFunctionInfo = &insert.first->second;
         
       } else {
@@ -146,62 +132,54 @@ void buildCGClosure(Module *m, FunctionsInfoMapTy& functionsMap, bool ignoreErro
     if (DEBUG) errs() << " mapped function " << funName(finfo->function) << "\n";
   }
   
-  // fill-in bitmaps of which functions are reachable from which - now we know the number of functions to do that
-  
-  if (DEBUG) errs() << "Allocating bitmaps and registering functions.\n";
+  if (DEBUG) errs() << "The graph has " << functions << " nodes and " << edges << " edges.\n";
+}
+
+static void indexFunctionInfos(FunctionsInfoMapTy& functionsMap, std::vector<FunctionInfo*>& infos) {
 
+  infos.assign(functionsMap.size(), NULL);
   for(FunctionsInfoMapTy::iterator FI = functionsMap.begin(), FE = functionsMap.end(); FI != FE; ++FI) {
     FunctionInfo& finfo = FI->second;
-    
-    for(std::vector<FunctionInfo*>::iterator TFI = finfo.calledFunctionsList.begin(), TFE = finfo.calledFunctionsList.end(); TFI != TFE; ++TFI) {
-      FunctionInfo *targetFinfo = *TFI;
-          
-      (finfo.callsFunctionMap)[targetFinfo->index] = true; 
-    }
+    myassert(finfo.index < infos.size());
+    infos[finfo.index] = &finfo;
   }
+}
+
+// reverse breadth-first search from the targets
+
+FunctionsBitsTy findCallersOf(FunctionsInfoMapTy& functionsMap, const std::vector<const FunctionInfo*>& targets) {
+
+  unsigned long functions = functionsMap.size();
+  std::vector<FunctionInfo*> infos;
+  indexFunctionInfos(functionsMap, infos);
   
-  // compute transitive closure
-  // no attempts were made to make this efficient
-  //     
-  // for each function node (function info)
-  //   for each call instruction (call info)
-  //     add targets reachable through 1 intermediate call to this call info
-  //
-  // repeat the above as long as at least one target has actually been added
-  
-  if (DEBUG) errs() << "Calculating transitive closure.\n";
-  int iterations = 0;
-  if (DEBUG) errs() << "The graph has " << functions << " nodes and " << edges << " edges.\n";
+  std::vector<std::vector<unsigned>> callers(functions);
+  for(unsigned long f = 0; f < functions; f++) {
+    std::vector<FunctionInfo*>& calls = infos[f]->calledFunctionsList;
+    for(std::vector<FunctionInfo*>::iterator TFI = calls.begin(), TFE = calls.end(); TFI != TFE; ++TFI) {
+      callers[(*TFI)->index].push_back(f);
+    }
+  }
   
-  for(unsigned long addedCalls = ULONG_MAX; addedCalls != 0; iterations++) {
-    addedCalls = 0;
-    unsigned long visitedCalls = 0;
-    unsigned long processedFunctions = 0;    
-    if (DEBUG) errs() << "Iteration " << iterations << "...";
-    for(FunctionsInfoMapTy::iterator FI = functionsMap.begin(), FE = functionsMap.end(); FI != FE; ++FI) {
-      FunctionInfo& finfo = FI->second;
-      processedFunctions++;
-      if (DEBUG && !(processedFunctions % (functions/10))) errs() << "#";
-      
-      std::vector<FunctionInfo*> toadd;
-      
-      for(std::vector<FunctionInfo*>::iterator MFI = finfo.calledFunctionsList.begin(), MFE = finfo.calledFunctionsList.end(); MFI != MFE; ++MFI) {
-        FunctionInfo *middleFinfo = *MFI;
-          
-        for(std::vector<FunctionInfo*>::iterator TFI = middleFinfo->calledFunctionsList.begin(), TFE = middleFinfo->calledFunctionsList.end(); TFI != TFE; ++TFI) {
-          FunctionInfo *targetFinfo = *TFI;
-              
-          if (!(finfo.callsFunctionMap)[targetFinfo->index]) {
-            (finfo.callsFunctionMap)[targetFinfo->index] = true;
-            toadd.push_back(targetFinfo);
-            addedCalls++;
-          }
-        }
+  std::shared_ptr<std::vector<uint64_t>> bits(new std::vector<uint64_t>((functions + 63) / 64, 0));
+  std::vector<unsigned> queue;
+  for(std::vector<const FunctionInfo*>::const_iterator TI = targets.begin(), TE = targets.end(); TI != TE; ++TI) {
+    queue.push_back((*TI)->index);
+  }
+  // the targets themselves are only included when they are (transitively) called from a target
+  for(size_t next = 0; next < queue.size(); next++) {
+    std::vector<unsigned>& fcallers = callers[queue[next]];
+    for(std::vector<unsigned>::iterator CI = fcallers.begin(), CE = fcallers.end(); CI != CE; ++CI) {
+      unsigned c = *CI;
+      uint64_t mask = ((uint64_t) 1) << (c & 63);
+      if (!((*bits)[c >> 6] & mask)) {
+        (*bits)[c >> 6] |= mask;
+        queue.push_back(c);
       }
-      
-      finfo.calledFunctionsList.insert(finfo.calledFunctionsList.end(), toadd.begin(), toadd.end());
-    } 
-    if (DEBUG) errs() << " added " << addedCalls << " calls out of " << visitedCalls << " visited calls.\n";
+    }
   }
-  delete cg;
+  
+  FunctionsBitsTy res;
+  res.words = bits;
+  return res;
 }
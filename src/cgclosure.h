@@ -4,7 +4,9 @@
 #include "common.h"
 
 #include <map>
+#include <memory>
 #include <set>
+#include <stdint.h>
 #include <vector>
 
 #include <llvm/IR/Instruction.h>
@@ -22,15 +24,27 @@ struct CallInfo {
   CallInfo(const Instruction* instruction, const FunctionInfo* target): instruction(instruction), target(target) {};
 };
 
+// set of functions (bit i is for the function with index i), in 64-bit words
+
+struct FunctionsBitsTy {
+  std::shared_ptr<const std::vector<uint64_t>> words;
+  
+  public:
+  FunctionsBitsTy(): words() {};
+  
+  bool operator[](unsigned long index) const {
+    return words && (index >> 6) < words->size() && (((*words)[index >> 6] >> (index & 63)) & 1);
+  }
+};
+
 struct FunctionInfo {  
   const Function* const function;
   std::vector<CallInfo> callInfos;
-  std::vector<bool> callsFunctionMap;
-  std::vector<FunctionInfo*> calledFunctionsList;
+  std::vector<FunctionInfo*> calledFunctionsList; // functions called directly, in the order of the calls
   const unsigned index;
   
   public:
-  FunctionInfo(const Function* const f, unsigned long index, unsigned long maxFunctions): function(f), callInfos(), callsFunctionMap(maxFunctions, false), index(index) {};
+  FunctionInfo(const Function* const f, unsigned long index): function(f), callInfos(), calledFunctionsList(), index(index) {};
 };
 
 typedef std::map<Function*, FunctionInfo> FunctionsInfoMapTy;
@@ -38,7 +52,13 @@ typedef std::map<Function*, FunctionInfo> FunctionsInfoMapTy;
 typedef std::unordered_set<Function*> FunctionsSetTy;
 typedef std::map<Function*, FunctionsSetTy*> CallEdgesMapTy;
 
-void buildCGClosure(Module *m, FunctionsInfoMapTy& functionsMap, bool ignoreErrorPaths = true, FunctionsSetTy *onlyFunctions = NULL, CallEdgesMapTy *onlyEdges = NULL, 
+// the callgraph with only the direct calls
+void buildCG(Module *m, FunctionsInfoMapTy& functionsMap, bool ignoreErrorPaths = true, FunctionsSetTy *onlyFunctions = NULL, CallEdgesMapTy *onlyEdges = NULL, 
   Function* externalFunction = NULL);
 
+// functions that (transitively) call any of the targets, for a callgraph
+// from buildCG; this is cheaper than a transitive closure when only a few
+// targets are of interest
+FunctionsBitsTy findCallersOf(FunctionsInfoMapTy& functionsMap, const std::vector<const FunctionInfo*>& targets);
+
 #endif
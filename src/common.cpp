@@ -1,9 +1,22 @@
 
 #include "common.h"
-
+#include "budget.h"
+#include "analyses.h"
+#include "snapshot.h"
+#include "symbols.h"
+#include "worklist.h"
+
+#include <algorithm>
+#include <cstdlib>
 #include <cxxabi.h>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <vector>
 
+#include <llvm/ADT/SmallString.h>
+
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/DebugInfo.h>
 #include <llvm/IR/Function.h>
@@ -19,6 +32,8 @@
 
 #include <llvm/Support/raw_ostream.h>
 
+SharedStateLockTy sharedStateLock;
+
 struct {
   bool operator()(Function *a, Function *b) {
   
@@ -50,6 +65,34 @@ void sortFunctionsByName(FunctionsOrderedSetTy& functionsOfInterestSet, Function
   std::sort(functionsOfInterestVector.begin(), functionsOfInterestVector.end(), FunctionLess);
 }
 
+bool extractOption(int& argc, char* argv[], const std::string& name, std::string& value) {
+
+  for(int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.compare(0, name.size(), name) != 0) {
+      continue;
+    }
+    int nremove;
+    if (arg.size() > name.size()) {
+      value = arg.substr(name.size() + (arg[name.size()] == '=' ? 1 : 0));
+      nremove = 1;
+    } else if (i + 1 < argc) {
+      value = argv[i + 1];
+      nremove = 2;
+    } else {
+      errs() << "ERROR: missing value for option " << name << "\n";
+      exit(1);
+    }
+    for(int j = i; j + nremove < argc; j++) {
+      argv[j] = argv[j + nremove];
+    }
+    argc -= nremove;
+    argv[argc] = NULL;
+    return true;
+  }
+  return false;
+}
+
 // supported usage
 //   tool
 //     processes R.bin.bc
@@ -60,45 +103,48 @@ void sortFunctionsByName(FunctionsOrderedSetTy& functionsOfInterestSet, Function
 //     from that module (but some tools need to do whole-program analysis
 //     which also will include functions from the base
 //      IR file not included in the module)
-Module *parseArgsReadIR(int argc, char* argv[], FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
+//
+//   tool --batch LIST path/R.bin.bc
+//     checks each module listed in file LIST (one file name per line) as
+//     above, reading the base file only once; the output for path/module.bc
+//     is written to path/module.tool
+//
+//   the state budget options (see budget.h), the worklist option (see
+//   worklist.h) and the number of threads (-j N) are accepted before the files
+
+static unsigned nJobs = 1;
+static std::string checkedFname;
+
+unsigned getJobs() {
+  return nJobs;
+}
 
-  if (argc > 3) {
-    errs() << argv[0] << " base_file.bc [module_file.bc]" << "\n";
-    exit(1);
-  }
+const std::string& getCheckedFname() {
+  return checkedFname;
+}
+
+static std::string outputFname(const std::string& fname, const std::string& toolName) {
+  SmallString<256> outFname(fname);
+  sys::path::replace_extension(outFname, toolName);
+  return outFname.str().str();
+}
+
+std::string getToolOutputFname(const std::string& toolName) {
+  return outputFname(checkedFname, toolName);
+}
+
+// links module from file moduleFname into base, the functions of interest
+// are those defined by the module
+
+static void linkModule(Module *base, const std::string& baseFname, const std::string& moduleFname, const char* toolPath,
+  FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
 
   SMDiagnostic error;
-  std::string baseFname;
-  
-  if (argc == 1) {
-    baseFname = "R.bin.bc";  
-  } else {
-    baseFname = argv[1];
-  }
-  
-  Module* base = parseIRFile(baseFname, error, context).release();
-  if (!base) {
-    errs() << "ERROR: Cannot read base IR file " << baseFname << "\n";
-    error.print(argv[0], errs());
-    exit(1);
-  }
-  
-  if (argc == 1 || argc == 2) {
-    // only a single input file
-    for(Module::iterator f = base->begin(), fe = base->end(); f != fe; ++f) {
-      Function *fun = &*f;
-      functionsOfInterestSet.insert(fun);
-    }
-    sortFunctionsByName(functionsOfInterestSet, functionsOfInterestVector);
-    return base;
-  }
-  
-  // have two input files
-  std::string moduleFname = argv[2];
+  checkedFname = moduleFname;
   std::unique_ptr<Module> module = parseIRFile(moduleFname, error, context);
   if (!module) {
     errs() << "ERROR: Cannot read module IR file " << moduleFname << "\n";
-    error.print(argv[0], errs());
+    error.print(toolPath, errs());
     exit(1);  
   }
   std::string errorMessage;
@@ -126,6 +172,9 @@ Module *parseArgsReadIR(int argc, char* argv[], FunctionsOrderedSetTy& functions
   if (Linker::linkModules(*base, move(module))) {
     errs() << "Linking module " << moduleFname << " with base " << baseFname << " resulted in an error.\n";
   }
+  forgetModuleAnalyses(base); // computed for the snapshot
+  findInstallCalls(base);
+  useBaseSnapshot(base, functionNames);
   
   for(std::vector<std::string>::iterator ni = functionNames.begin(), ne = functionNames.end(); ni != ne; ++ni) {
     std::string name = *ni;
@@ -138,6 +187,119 @@ Module *parseArgsReadIR(int argc, char* argv[], FunctionsOrderedSetTy& functions
   }
 
   sortFunctionsByName(functionsOfInterestSet, functionsOfInterestVector);
+}
+
+// batch mode: the base is read (and its snapshot prepared) only once, each
+// module from the list is checked in a child process, which links the module
+// into its (copy-on-write) copy of the base and returns to run the tool;
+// the output goes to the module file name with extension replaced by the
+// tool name, as with check_package.sh
+//
+//   returns only in the child processes
+
+static void checkBatch(Module *base, const std::string& baseFname, const std::string& batchFname, const char* toolPath,
+  FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
+
+  std::ifstream in(batchFname);
+  if (!in) {
+    errs() << "ERROR: Cannot read batch file " << batchFname << "\n";
+    exit(1);
+  }
+  std::string toolName = sys::path::filename(toolPath).str();
+  prepareBaseSnapshot(base, baseFname);
+
+  unsigned nFailed = 0;
+  std::string moduleFname;
+  while(std::getline(in, moduleFname)) {
+    if (moduleFname.empty()) {
+      continue;
+    }
+    std::string outFname = outputFname(moduleFname, toolName);
+
+    outs().flush();
+    errs().flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+      errs() << "ERROR: Cannot fork to check " << moduleFname << "\n";
+      exit(1);
+    }
+    if (pid == 0) {
+      int fd = open(outFname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      if (fd < 0) {
+        errs() << "ERROR: Cannot write output file " << outFname << "\n";
+        exit(1);
+      }
+      dup2(fd, STDOUT_FILENO);
+      dup2(fd, STDERR_FILENO);
+      close(fd);
+      linkModule(base, baseFname, moduleFname, toolPath, functionsOfInterestSet, functionsOfInterestVector, context);
+      return;
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      errs() << "ERROR: Checking " << moduleFname << " failed, see " << outFname << "\n";
+      nFailed++;
+    }
+  }
+  exit(nFailed ? 1 : 0);
+}
+
+Module *parseArgsReadIR(int& argc, char* argv[], FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
+
+  parseBudgetOptions(argc, argv);
+  parseWorkListOptions(argc, argv);
+  parseSnapshotOptions(argc, argv);
+  
+  std::string jobsArg;
+  if (extractOption(argc, argv, "-j", jobsArg)) {
+    nJobs = std::max(atoi(jobsArg.c_str()), 1);
+  }
+  std::string batchFname;
+  extractOption(argc, argv, "--batch", batchFname);
+
+  if (argc > 3 || (!batchFname.empty() && argc > 2)) {
+    errs() << argv[0] << " [-j N] [--max-states N] [--max-memory SIZE] [--max-time SECONDS] [--worklist STRATEGY] [--snapshot FILE] base_file.bc [module_file.bc]" << "\n";
+    errs() << argv[0] << " [options] --batch LIST base_file.bc" << "\n";
+    exit(1);
+  }
+
+  SMDiagnostic error;
+  std::string baseFname;
+  
+  if (argc == 1) {
+    baseFname = "R.bin.bc";  
+  } else {
+    baseFname = argv[1];
+  }
+  checkedFname = baseFname;
+  
+  Module* base = parseIRFile(baseFname, error, context).release();
+  if (!base) {
+    errs() << "ERROR: Cannot read base IR file " << baseFname << "\n";
+    error.print(argv[0], errs());
+    exit(1);
+  }
+  findInstallCalls(base);
+  
+  if (!batchFname.empty()) {
+    checkBatch(base, baseFname, batchFname, argv[0], functionsOfInterestSet, functionsOfInterestVector, context);
+    return base;
+  }
+
+  if (argc == 1 || argc == 2) {
+    // only a single input file
+    for(Module::iterator f = base->begin(), fe = base->end(); f != fe; ++f) {
+      Function *fun = &*f;
+      functionsOfInterestSet.insert(fun);
+    }
+    sortFunctionsByName(functionsOfInterestSet, functionsOfInterestVector);
+    return base;
+  }
+  
+  // have two input files
+  prepareBaseSnapshot(base, baseFname);
+  linkModule(base, baseFname, argv[2], argv[0], functionsOfInterestSet, functionsOfInterestVector, context);
   return base;
 }
 
@@ -243,6 +405,7 @@ std::string computeVarName(const AllocaInst *var) {
 std::string varName(const AllocaInst *var) {
 
   static VarNamesTy cache;
+  std::lock_guard<SharedStateLockTy> lock(sharedStateLock);
   
   auto vsearch = cache.find(var);
   if (vsearch != cache.end()) {
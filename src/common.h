@@ -12,6 +12,7 @@ void myassert_fail (const char *assertion, const char *file, unsigned int line,
 #endif
 
 
+#include <mutex>
 #include <set>
 #include <unordered_set>
 #include <unordered_map>
@@ -43,7 +44,26 @@ struct VarBoolCacheTy_hash {
 };
 typedef std::unordered_map<AllocaInst*,bool,VarBoolCacheTy_hash> VarBoolCacheTy;
 
-Module *parseArgsReadIR(int argc, char* argv[], FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context);
+Module *parseArgsReadIR(int& argc, char* argv[], FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context);
+
+// the file being checked by parseArgsReadIR, the module file or (when
+// checking only the base) the base file
+const std::string& getCheckedFname();
+
+// the output file of a tool for the checked file (extension replaced by the tool name)
+std::string getToolOutputFname(const std::string& toolName);
+
+// removes option "name value", "namevalue" or "name=value" (e.g. "-j 4" or "-j4") from the arguments
+//   returns true if the option was found
+bool extractOption(int& argc, char* argv[], const std::string& name, std::string& value);
+
+// number of threads to use for module-wide analyses and checking (option -j N, default 1)
+unsigned getJobs();
+
+// serializes updates of module-wide shared data (interning tables, caches, LLVM constants)
+//   when functions are checked concurrently
+typedef std::recursive_mutex SharedStateLockTy;
+extern SharedStateLockTy sharedStateLock;
 
 std::string demangle(std::string name);
 
@@ -22,16 +22,11 @@
 
 #include "callocators.h"
 #include "lannotate.h"
+#include "tools.h"
 
 using namespace llvm;
 
-int main(int argc, char* argv[])
-{
-  LLVMContext context;
-
-  FunctionsOrderedSetTy functionsOfInterestSet;
-  FunctionsVectorTy functionsOfInterestVector;
-  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);
+static int runCsfpcheck(Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
   CalledModuleTy *cm = CalledModuleTy::create(m);
 
   const CallSiteTargetsTy *callSiteTargets = cm->getCallSiteTargets();
@@ -59,6 +54,15 @@ int main(int argc, char* argv[])
   printLineAnnotations(sfpLines);
   
   CalledModuleTy::release(cm);  
-  delete m;
-}  
+  return 0;
+}
+
+const ToolTy csfpcheckTool = { "csfpcheck", NULL, runCsfpcheck };
+
+#ifndef RCHK_DRIVER
+int main(int argc, char* argv[])
+{
+  return runTool(argc, argv, csfpcheckTool);
+}
+#endif
 
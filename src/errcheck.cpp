@@ -15,19 +15,13 @@
 
 #include <llvm/Support/raw_ostream.h>
 
-#include "errors.h"
+#include "analyses.h"
+#include "tools.h"
 
 using namespace llvm;
 
-int main(int argc, char* argv[])
-{
-  LLVMContext context;
-  FunctionsOrderedSetTy functionsOfInterestSet;
-  FunctionsVectorTy functionsOfInterestVector;  
-  
-  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);
-  FunctionsSetTy errorFunctions;
-  findErrorFunctions(m, errorFunctions);
+static int runErrcheck(Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
+  FunctionsSetTy& errorFunctions = *getModuleAnalyses(m)->getErrorFunctions();
   
   for(FunctionsVectorTy::iterator fi = functionsOfInterestVector.begin(), fe = functionsOfInterestVector.end(); fi != fe; ++fi) {
     Function *fun = *fi;
@@ -51,5 +45,14 @@ int main(int argc, char* argv[])
       }
     }
   }
-  delete m;
-} 
+  return 0;
+}
+
+const ToolTy errcheckTool = { "errcheck", NULL, runErrcheck };
+
+#ifndef RCHK_DRIVER
+int main(int argc, char* argv[])
+{
+  return runTool(argc, argv, errcheckTool);
+}
+#endif
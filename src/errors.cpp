@@ -1,7 +1,11 @@
 
 #include "errors.h"
+#include "snapshot.h"
+
+#include <vector>
 
 #include <llvm/IR/CallSite.h>
+#include <llvm/IR/CFG.h>
 #include <llvm/IR/Instructions.h>
 
 using namespace llvm;
@@ -46,31 +50,25 @@ static bool checkAndAnalyzeErrorFunction(Function *fun, FunctionsSetTy *knownErr
     classified_block: ;
   }
   
-  // now add to returning blocks all blocks that can reach a returning block
-  
-  bool addedReturningBlock = !returningBlocks.empty();
-  while(addedReturningBlock) {
-
-    addedReturningBlock = false;
-    for(Function::iterator bb = fun->begin(), bbe = fun->end(); bb != bbe; ++bb) {
-      if (errorBlocks.find(&*bb) == errorBlocks.end() &&
-        returningBlocks.find(&*bb) == returningBlocks.end()) {
-        
-        TerminatorInst *t = bb->getTerminator();
-        for(int i = 0, nsucc = t->getNumSuccessors(); i < nsucc; i++) {
-          BasicBlock *succ = t->getSuccessor(i);
-          if (returningBlocks.find(succ) != returningBlocks.end()) {
-            if (onlyCheck && entry == &*bb) {
-              return false;
-            }          
-            returningBlocks.insert(&*bb);
-            addedReturningBlock = true;
-            break;
-          }
-        }
+  // now add to returning blocks all blocks that can reach a returning block,
+  //   walking backwards from the returning blocks found so far
+
+  std::vector<BasicBlock*> workList(returningBlocks.begin(), returningBlocks.end());
+  while(!workList.empty()) {
+    BasicBlock *bb = workList.back();
+    workList.pop_back();
+
+    for(pred_iterator pi = pred_begin(bb), pe = pred_end(bb); pi != pe; ++pi) {
+      BasicBlock *pb = *pi;
+      if (errorBlocks.find(pb) != errorBlocks.end() || !returningBlocks.insert(pb).second) {
+        continue;
+      }
+      if (onlyCheck && entry == pb) {
+        return false;
       }
+      workList.push_back(pb);
     }
-  }    
+  }
   // entry block is not a returning block    
   return returningBlocks.find(entry) == returningBlocks.end();
 }
@@ -102,21 +100,52 @@ void findErrorBasicBlocks(Function *fun, FunctionsSetTy *knownErrorFunctions, Ba
 
 // find all functions from module m that do not return, place them into
 // errorFunctions
+//
+//   each function is checked once; when a new error function is found, only
+//   its callers are checked again
 
 void findErrorFunctions(Module *m, FunctionsSetTy& errorFunctions) {
 
-  bool addedErrorFunction = true;
-  while(addedErrorFunction) {
-    addedErrorFunction = false;
-    for(Module::iterator FI = m->begin(), FE = m->end(); FI != FE; ++FI) {
-      Function *fun = &*FI;
+  const BaseSnapshotTy* snapshot = getBaseSnapshot();
+  if (snapshot) {
+    addFunctionsByName(m, snapshot->errorFunctions, errorFunctions);
+  }
+
+  std::vector<Function*> workList;
+  FunctionsSetTy onWorkList;
 
-      if (!fun) continue;
-      if (!fun->size()) continue;
-    
-      if (errorFunctions.find(fun) == errorFunctions.end() && isErrorFunction(fun, &errorFunctions)) {
-        errorFunctions.insert(fun);
-        addedErrorFunction = true;
+  for(Module::iterator FI = m->begin(), FE = m->end(); FI != FE; ++FI) {
+    Function *fun = &*FI;
+
+    if (!fun->size()) continue;
+    if (snapshot && snapshot->isBaseFunction(fun)) continue;
+    if (errorFunctions.find(fun) != errorFunctions.end()) continue;
+
+    workList.push_back(fun);
+    onWorkList.insert(fun);
+  }
+
+  while(!workList.empty()) {
+    Function *fun = workList.back();
+    workList.pop_back();
+    onWorkList.erase(fun);
+
+    if (errorFunctions.find(fun) != errorFunctions.end() || !isErrorFunction(fun, &errorFunctions)) {
+      continue;
+    }
+    errorFunctions.insert(fun);
+
+    for(Value::user_iterator ui = fun->user_begin(), ue = fun->user_end(); ui != ue; ++ui) {
+      CallSite cs(*ui);
+      if (!cs || cs.getCalledFunction() != fun) {
+        continue;
+      }
+      Function *caller = cs.getInstruction()->getParent()->getParent();
+      if (snapshot && snapshot->isBaseFunction(caller)) continue;
+      if (errorFunctions.find(caller) != errorFunctions.end()) continue;
+
+      if (onWorkList.insert(caller).second) {
+        workList.push_back(caller);
       }
     }
   }
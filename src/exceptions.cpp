@@ -62,6 +62,11 @@ bool isKnownVectorReturningFunction(const CalledFunctionTy* f) {
   return false;
 }
 
+bool hasContextSensitiveException(Function *f) {
+  if (f->getName() == "Rf_getAttrib") return true; // isKnownVectorReturningFunction
+  return false;
+}
+
 bool isAssertedNonAllocating(const CalledFunctionTy *f) {
   return isAssertedNonAllocating(f->fun);
 }
@@ -29,5 +29,6 @@ bool protectsArguments(Function *f);
 bool protectsArguments(const CalledFunctionTy *f);
 
 bool isKnownVectorReturningFunction(const CalledFunctionTy *f);
+bool hasContextSensitiveException(Function *f); // arguments (context) used by the exceptions above
 
 #endif
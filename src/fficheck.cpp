@@ -19,6 +19,7 @@
 #include <unordered_set>
 
 #include "symbols.h"
+#include "tools.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -176,51 +177,37 @@ bool checkTable(Value *v, bool checkDotCallArity, StringMapTy& smap) {
   return true; /* successful parsing */
 }
 
-int main(int argc, char* argv[])
-{
-  LLVMContext context;
-  FunctionsOrderedSetTy functionsOfInterestSet;
-  FunctionsVectorTy functionsOfInterestVector;
-
-  /* fficheck [-i] base.bc packagelib.bc */
-  
-  // most likely the base.bc is not really needed, at least for now
-  // -i means read (additional) list of functions to check from the command line
-  //   such functions are given using symbol names that are translated using
-  //   the registration table to function names where the registration exists
-  //   (called with names found in .Call() and .External() calls in R source code)
+/* fficheck [-i] base.bc packagelib.bc */
 
-  // get package name from the last argument
-  // there should be a more reliable way..
+// most likely the base.bc is not really needed, at least for now
+// -i means read (additional) list of functions to check from the command line
+//   such functions are given using symbol names that are translated using
+//   the registration table to function names where the registration exists
+//   (called with names found in .Call() and .External() calls in R source code)
 
-  if (argc < 2) {
-    errs() << "fficheck [-i] R.bc pkg.so.bc\n";
-    return 2;
-  }
+static bool readFunList = false;
 
-  bool readFunList = false;
-  if (!strcmp(argv[1], "-i")) {
-    readFunList = true;
-    char **argvc = (char **) malloc(argc * sizeof(char *));
-    if (!argvc) {
-      errs() << "Out of memory.\n";
-      return 1;
-    }
-    argvc[0] = argv[0];
-    int j = 1;
-    for(int i = 2; i < argc; i++)
-      argvc[j++] = argv[i];
-    argvc[j++] = NULL;
-    argc--;
-    argv = argvc;
+static void parseFficheckOptions(int& argc, char* argv[]) {
 
-    if (argc < 2) {
-      errs() << "fficheck [-i] R.bc pkg.so.bc\n";
-      return 2;
+  for(int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-i")) {
+      readFunList = true;
+      for(int j = i; j + 1 < argc; j++) {
+        argv[j] = argv[j + 1];
+      }
+      argc--;
+      argv[argc] = NULL;
+      break;
     }
   }
-  
-  char *s = argv[argc-1];
+}
+
+static int runFficheck(Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
+
+  // get package name from the checked file name
+  // there should be a more reliable way..
+
+  const char *s = getCheckedFname().c_str();
   int i;
   int sep = -1;
   for(i = 0; s[i] != 0; i++)
@@ -247,8 +234,6 @@ int main(int argc, char* argv[])
      This is often a package name, but not always, but it is always the name that
      defines the suffix in R_init_suffix and it is used here only for that purpose.
   */
-  
-  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);
  
   std::string initfn = "R_init_";
   initfn.append(pkgname);
@@ -348,10 +333,15 @@ int main(int argc, char* argv[])
         break;
     }
     errs() << "Checked additional specified functions: " << checked << "\n";
-    free(argv);
   }
-  
-  
-  delete m;
   return 0;
 }
+
+const ToolTy fficheckTool = { "fficheck", parseFficheckOptions, runFficheck };
+
+#ifndef RCHK_DRIVER
+int main(int argc, char* argv[])
+{
+  return runTool(argc, argv, fficheckTool);
+}
+#endif
@@ -28,21 +28,21 @@ static void pruneFreshVars(Instruction *in, FreshVarsTy& freshVars, LiveVarsTy&
   for (FreshVarsVarsTy::iterator fi = freshVars.vars.begin(), fe = freshVars.vars.end(); fi != fe;) {
     AllocaInst *var = fi->first;
       
-    auto lsearch = liveVars.find(in);
-    myassert(lsearch != liveVars.end());
+    const VarsLiveness* lvars = liveVars.find(in);
+    myassert(lvars);
       
-    VarsLiveness& lvars = lsearch->second;
-    if (!lvars.isPossiblyUsed(var)) {
+    if (!lvars->isPossiblyUsed(var)) {
       fi = freshVars.vars.erase(fi);
       freshVars.condMsgs.erase(var);
       continue;
 
-    } else if (!lvars.isPossiblyKilled(var)) {
+    } else if (!lvars->isPossiblyKilled(var)) {
       auto msearch = freshVars.condMsgs.find(var);
       if (msearch != freshVars.condMsgs.end()) {
-        msearch->second.flush();
-        refinableInfos++;
+        DelayedLineMessenger dmsg = msearch->second;
         freshVars.condMsgs.erase(msearch);
+        dmsg.flush();
+        refinableInfos++;
         if (msg.debug()) msg.debug(MSG_PFX + "printed conditional messages as variable " + varName(var) + " is now definitely going to be used", in);
       }
     }
@@ -53,18 +53,17 @@ static void pruneFreshVars(Instruction *in, FreshVarsTy& freshVars, LiveVarsTy&
 static void unprotectAll(FreshVarsTy& freshVars) {
   freshVars.pstack.clear();
   for (FreshVarsVarsTy::iterator fi = freshVars.vars.begin(), fe = freshVars.vars.end(); fi != fe; ++fi) {
-    fi->second = 0; // zero protect count
+    freshVars.vars.set(fi, 0); // zero protect count
   }
 }
 
 static void issueConditionalMessage(Instruction *in, AllocaInst *var, FreshVarsTy& freshVars, LineMessenger& msg, unsigned& refinableInfos,
     LiveVarsTy& liveVars, std::string& message) {
 
-  auto lsearch = liveVars.find(in);
-  if (lsearch != liveVars.end()) {
+  const VarsLiveness* vlive = liveVars.find(in);
+  if (vlive) {
     // there should be a record for all instructions
-    VarsLiveness& vlive = lsearch->second;
-    if (vlive.isDefinitelyUsed(var)) {
+    if (vlive->isDefinitelyUsed(var)) {
       msg.info(MSG_PFX + message, in);
       if (msg.trace()) msg.trace("issued an info directly because variable \"" + varName(var) + "\" is definitely live", in);
       refinableInfos++;
@@ -80,13 +79,15 @@ static void issueConditionalMessage(Instruction *in, AllocaInst *var, FreshVarsT
     freshVars.condMsgs.insert({var, dmsg});
     if (msg.debug()) msg.debug(MSG_PFX + "created conditional message \"" + message + "\" first for variable " + varName(var), in);
   } else {
-    DelayedLineMessenger& dmsg = vsearch->second;
+    DelayedLineMessenger dmsg = vsearch->second;
     dmsg.info(MSG_PFX + message, in);
+    freshVars.condMsgs.erase(vsearch);
+    freshVars.condMsgs.insert({var, dmsg});
     if (msg.debug()) msg.debug(MSG_PFX + "added conditional message \"" + message + "\" for variable " + varName(var) + "(size " + std::to_string(dmsg.size()) + ")", in);
   }
 }
 
-static bool isVarCheckedFresh(AllocaInst *var) {
+bool isVarCheckedFresh(AllocaInst *var) {
 
   for(Value::user_iterator ui = var->user_begin(), ue = var->user_end(); ui != ue; ++ui) {
     User *u = *ui;
@@ -104,27 +105,21 @@ static bool isVarCheckedFresh(AllocaInst *var) {
   return true;
 }
 
-static bool isVarCheckedFresh(AllocaInst *var, VarBoolCacheTy& cache, LineMessenger& msg) {
+static bool isVarCheckedFresh(AllocaInst *var, FunctionVarsTy& vars, LineMessenger& msg) {
 
   if (!isSEXP(var)) {
     return false;
   }
 
-  auto vsearch = cache.find(var);
-  if (vsearch != cache.end()) {
-    return vsearch->second;
-  }
+  bool isChecked = vars.is(var, VK_CHECKED_FRESH);
   
-  bool isChecked = isVarCheckedFresh(var);
-  
-  if (!isChecked) {
+  if (!isChecked && vars.markReported(var)) {
     // the message is here to make sure it is printed only once
     //   the line messenger mechanism for printing unique messages won't do in practice
     //   because generating the message is too expensive
     msg.info(MSG_PFX + "ignoring variable " + varName(var) + " as it has address taken, results will be incomplete ", NULL);  
   }
   
-  cache.insert({var, isChecked});
   return isChecked;
 }
 
@@ -155,13 +150,13 @@ static void unprotectOne(FreshVarsTy& freshVars, LineMessenger& msg, unsigned& r
     } else {
       if (msg.debug()) msg.debug(MSG_PFX + "decremented protect count of variable " + varName(var) + " to " + std::to_string(nProtects), in);
     }
-    vsearch->second = nProtects;
+    freshVars.vars.set(vsearch, nProtects);
   }
   if (msg.debug()) msg.debug(MSG_PFX + "unprotected variable " + varName(var), in);
 }
 
 static void handleCall(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *sexpGuardsChecker, SEXPGuardsTy *sexpGuards, FreshVarsTy& freshVars,
-    LineMessenger& msg, unsigned& refinableInfos, LiveVarsTy& liveVars, CProtectInfo& cprotect, BalanceStateTy* balance, VarBoolCacheTy& checkedVarsCache) {
+    LineMessenger& msg, unsigned& refinableInfos, LiveVarsTy& liveVars, CProtectInfo& cprotect, BalanceStateTy* balance, FunctionVarsTy& vars) {
   
   bool confused = QUIET_WHEN_CONFUSED && freshVars.confused;
 
@@ -294,7 +289,7 @@ static void handleCall(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *s
         }
       }
       
-      if (var && !isVarCheckedFresh(var, checkedVarsCache, msg)) {
+      if (var && !isVarCheckedFresh(var, vars, msg)) {
         var = NULL; // fall back below into pushing anonymous value on the stack
       }
     
@@ -315,7 +310,7 @@ static void handleCall(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *s
             // typically it was before protected just once, so lets set its protect count to 1
           
             nProtects = 1;
-            vsearch->second = nProtects;
+            freshVars.vars.set(vsearch, nProtects);
             if (msg.debug()) msg.debug(MSG_PFX + "set protect count of variable " + varName(var) + " to 1 at REPROTECT (heuristic)", in);
           }	
         } else {
@@ -350,7 +345,7 @@ static void handleCall(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *s
         auto vsearch = freshVars.vars.find(var);
         if (vsearch != freshVars.vars.end()) {
           int nProtects = vsearch->second;
-          vsearch->second = ++nProtects;
+          freshVars.vars.set(vsearch, ++nProtects);
           if (msg.debug()) msg.debug(MSG_PFX + "incremented protect count of variable " + varName(var) + " to " + std::to_string(nProtects), in); 
         } else {
           // the variable is not currently fresh, but the fact that it is being protected actually means
@@ -434,7 +429,7 @@ static void handleCall(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *s
         // (well, except that the value may be used again, in the LLVM bitcode -- it is an approximation that we ignore this)
         continue;
       }
-      msg.info(MSG_PFX + "calling allocating function " + funName(tgt) + " with argument allocated using " + funName(src), in);
+      msg.info(MSG_PFX + "calling allocating function " + cm->getCallName(in, sexpGuardsChecker, sexpGuards) + " with argument allocated using " + cm->getCallName(arg, sexpGuardsChecker, sexpGuards), in);
       refinableInfos++;
     }
   }
@@ -446,7 +441,7 @@ static void handleCall(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *s
   pruneFreshVars(in, freshVars, liveVars, msg, refinableInfos); // make sure messages are not emitted for (obviously) dead variables
   if (freshVars.vars.size() > 0) {
   
-    if (msg.trace()) msg.trace(MSG_PFX + "checking freshvars at allocating call to " + funName(tgt), in);
+    if (msg.trace()) msg.trace(MSG_PFX + "checking freshvars at allocating call to " + cm->getCallName(in, sexpGuardsChecker, sexpGuards), in);
   
     // compute all variables passed to the call
     //   (if a fresh variable is passed to a function, it is not to be reported here as error, but it is done at handleLoad)
@@ -490,17 +485,17 @@ static void handleCall(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *s
       
       int nProtects = fi->second;
       if (nProtects > 0) { // the variable is not really currently fresh, it is protected
-        if (msg.trace()) msg.trace(MSG_PFX + "variable " + varName(var) + " has protect count " + std::to_string(nProtects) + " when passed to function " + funName(tgt) + " so not reported", in);
+        if (msg.trace()) msg.trace(MSG_PFX + "variable " + varName(var) + " has protect count " + std::to_string(nProtects) + " when passed to function " + cm->getCallName(in, sexpGuardsChecker, sexpGuards) + " so not reported", in);
         continue;
       }
       
       if (passedVars.find(var) != passedVars.end()) {
-        if (msg.trace()) msg.trace(MSG_PFX + "fresh variable " + varName(var) + " is passed to function " + funName(tgt) + " so not reported", in);
+        if (msg.trace()) msg.trace(MSG_PFX + "fresh variable " + varName(var) + " is passed to function " + cm->getCallName(in, sexpGuardsChecker, sexpGuards) + " so not reported", in);
         // this fresh variable is in fact being passed to the function, so don't report it
         continue;
       }
       
-      std::string message = "unprotected variable " + varName(var) + " while calling allocating function " + funName(tgt);
+      std::string message = "unprotected variable " + varName(var) + " while calling allocating function " + cm->getCallName(in, sexpGuardsChecker, sexpGuards);
       issueConditionalMessage(in, var, freshVars, msg, refinableInfos, liveVars, message);
     }
   }
@@ -525,9 +520,10 @@ static void handleLoad(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker* s
   // check for conditional messages
   auto msearch = freshVars.condMsgs.find(var);
   if (msearch != freshVars.condMsgs.end()) {
-    msearch->second.flush();
-    refinableInfos++;
+    DelayedLineMessenger dmsg = msearch->second;
     freshVars.condMsgs.erase(msearch);
+    dmsg.flush();
+    refinableInfos++;
     if (msg.debug()) msg.debug(MSG_PFX + "printed conditional messages on use of variable " + varName(var), in);
   }
   
@@ -616,6 +612,7 @@ static void handleLoad(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker* s
     return; // the variable is callee-protect for the given argument
   }
 
+  std::string tgtName = cm->getCallName(li->user_back(), sexpGuardsChecker, sexpGuards);
   std::string nameSuffix = "";
   if (var->getName().str().empty()) {
     nameSuffix = " <arg " + std::to_string(aidx+1) + ">";
@@ -625,7 +622,7 @@ static void handleLoad(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker* s
     // passing an unprotected argument to a function parameter that is not callee-safe, this is always an error
     
 
-    msg.info(MSG_PFX + "calling allocating function " + funName(tgt) + " with a fresh pointer (" + varName(var) + nameSuffix + ")", in);
+    msg.info(MSG_PFX + "calling allocating function " + tgtName + " with a fresh pointer (" + varName(var) + nameSuffix + ")", in);
     refinableInfos++;
   }
   
@@ -635,7 +632,7 @@ static void handleLoad(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker* s
   Instruction *callIn = cs.getInstruction();
   myassert(callIn == li->user_back());
   
-  std::string message = "allocating function " + funName(tgt) + " may destroy its unprotected argument ("
+  std::string message = "allocating function " + tgtName + " may destroy its unprotected argument ("
     + varName(var) + nameSuffix + "), which is later used.";
 
   issueConditionalMessage(in, var, freshVars, msg, refinableInfos, liveVars, message);
@@ -673,7 +670,7 @@ static void unfreshAliasedVars(Instruction *useInst, AllocaInst *useVar, FreshVa
 }
 
 static void handleStore(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *sexpGuardsChecker, SEXPGuardsTy *sexpGuards, 
-  FreshVarsTy& freshVars, LineMessenger& msg, unsigned& refinableInfos, BalanceStateTy* balance, VarBoolCacheTy& checkedVarsCache) {
+  FreshVarsTy& freshVars, LineMessenger& msg, unsigned& refinableInfos, BalanceStateTy* balance, FunctionVarsTy& vars) {
   
   if (QUIET_WHEN_CONFUSED && freshVars.confused) {
     return;
@@ -734,7 +731,7 @@ static void handleStore(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *
     return;
   }
   AllocaInst *var = cast<AllocaInst>(storePointerOp);
-  if (!isVarCheckedFresh(var, checkedVarsCache, msg)) {
+  if (!isVarCheckedFresh(var, vars, msg)) {
     return;
   }
   
@@ -797,10 +794,10 @@ static void handleStore(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *
         freshVars.vars.insert({var, nProtects});
         // remember, insert won't overwrite std::map value for an existing key
       } else {
-        vsearch->second = nProtects;
+        freshVars.vars.set(vsearch, nProtects);
       }
       if (msg.debug()) msg.debug(MSG_PFX + "initialized fresh SEXP variable " + varName(var) + " with protect count " + std::to_string(nProtects) +
-        " allocated by " + funName(srcFun), in);
+        " allocated by " + cm->getCallName(storeValueOp, sexpGuardsChecker, sexpGuards), in);
       return;
     }
   }
@@ -809,7 +806,7 @@ static void handleStore(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *
       if (dgep->isInBounds()) {
         if (LoadInst *dlis = dyn_cast<LoadInst>(dgep->getOperand(0))) {
           if (AllocaInst *dvars = dyn_cast<AllocaInst>(dlis->getPointerOperand())) {
-            if (isVarCheckedFresh(dvars, checkedVarsCache, msg)) {
+            if (isVarCheckedFresh(dvars, vars, msg)) {
               auto vssearch = freshVars.vars.find(dvars);
               if (vssearch != freshVars.vars.end() && vssearch->second == 0) {
                 // handle var = ATTRIB(var1) where var1 is fresh
@@ -821,7 +818,7 @@ static void handleStore(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *
                   freshVars.vars.insert({var, nProtects});
                   // remember, insert won't overwrite std::map value for an existing key
                 } else {
-                  vsearch->second = nProtects;
+                  freshVars.vars.set(vsearch, nProtects);
                 }
                 if (msg.debug()) msg.debug(MSG_PFX + "initialized fresh SEXP variable " + varName(var) + " with protect count " + std::to_string(nProtects) +
                   " based on derived assignment from fresh variable " + varName(dvars), in);
@@ -842,11 +839,11 @@ static void handleStore(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *
 }
 
 void handleFreshVarsForNonTerminator(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *sexpGuardsChecker, SEXPGuardsTy *sexpGuards,
-    FreshVarsTy& freshVars, LineMessenger& msg, unsigned& refinableInfos, LiveVarsTy& liveVars, CProtectInfo& cprotect, BalanceStateTy* balance, VarBoolCacheTy& checkedVarsCache) {
+    FreshVarsTy& freshVars, LineMessenger& msg, unsigned& refinableInfos, LiveVarsTy& liveVars, CProtectInfo& cprotect, BalanceStateTy* balance, FunctionVarsTy& vars) {
 
-  handleCall(in, cm, sexpGuardsChecker, sexpGuards, freshVars, msg, refinableInfos, liveVars, cprotect, balance, checkedVarsCache);
+  handleCall(in, cm, sexpGuardsChecker, sexpGuards, freshVars, msg, refinableInfos, liveVars, cprotect, balance, vars);
   handleLoad(in, cm, sexpGuardsChecker, sexpGuards, freshVars, msg, refinableInfos, liveVars, cprotect);
-  handleStore(in, cm, sexpGuardsChecker, sexpGuards, freshVars, msg, refinableInfos, balance, checkedVarsCache);
+  handleStore(in, cm, sexpGuardsChecker, sexpGuards, freshVars, msg, refinableInfos, balance, vars);
 }
 
 void handleFreshVarsForTerminator(Instruction *in, FreshVarsTy& freshVars, LiveVarsTy& liveVars) {
@@ -868,7 +865,7 @@ void StateWithFreshVarsTy::dump(bool verbose) {
     auto vsearch = freshVars.condMsgs.find(var);
     if (vsearch != freshVars.condMsgs.end()) {
       errs() << " conditional messages: \n";
-      DelayedLineMessenger& dmsg = vsearch->second;
+      const DelayedLineMessenger& dmsg = vsearch->second;
       dmsg.print("    ");
     }
     
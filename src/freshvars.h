@@ -6,9 +6,12 @@
 #include "linemsg.h"
 #include "state.h"
 #include "guards.h"
+#include "hashed.h"
 #include "liveness.h"
+#include "localvars.h"
 #include "cprotect.h"
 #include "balance.h"
+#include "region.h"
 
 #include <vector>
 
@@ -19,9 +22,22 @@ using namespace llvm;
 
 const int MAX_PSTACK_SIZE = 64;
 
-typedef std::map<AllocaInst*, int> FreshVarsVarsTy;
-typedef std::map<AllocaInst*, DelayedLineMessenger> ConditionalMessagesTy;
-typedef std::vector<AllocaInst*> VarsVectorTy;
+struct FreshVar_entryHash {
+  size_t operator()(AllocaInst* var, int nProtects) const {
+    return hash_combine(var, nProtects);
+  }
+};
+
+struct ConditionalMessage_entryHash {
+  size_t operator()(AllocaInst* var, const DelayedLineMessenger& dmsg) const {
+    return hash_combine(var, hash_combine_range(dmsg.delayedLineBuffer.begin(), dmsg.delayedLineBuffer.end())); // messages are interned
+  }
+};
+
+  // these are part of checking states, hence the region allocator
+typedef HashedMap<AllocaInst*, int, FreshVar_entryHash, RegionAllocator<std::pair<AllocaInst* const, int>>> FreshVarsVarsTy;
+typedef HashedMap<AllocaInst*, DelayedLineMessenger, ConditionalMessage_entryHash, RegionAllocator<std::pair<AllocaInst* const, DelayedLineMessenger>>> ConditionalMessagesTy;
+typedef HashedStack<AllocaInst*, RegionAllocator<AllocaInst*>> VarsVectorTy;
 
 struct FreshVarsTy {
   FreshVarsVarsTy vars;
@@ -61,9 +77,12 @@ struct StateWithFreshVarsTy : virtual public StateBaseTy {
   void dump(bool verbose);
 };
 
+// the variable can be tracked (only loaded and stored)
+bool isVarCheckedFresh(AllocaInst *var);
+
 void handleFreshVarsForNonTerminator(Instruction *in, CalledModuleTy *cm, SEXPGuardsChecker *sexpGuardsChecker, SEXPGuardsTy *sexpGuards,
   FreshVarsTy& freshVars, LineMessenger& msg, unsigned& refinableInfos, LiveVarsTy& liveVars, CProtectInfo& cprotect, BalanceStateTy* balance,
-  VarBoolCacheTy& checkedVarsCache);
+  FunctionVarsTy& vars);
 
 void handleFreshVarsForTerminator(Instruction *in, FreshVarsTy& freshVars, LiveVarsTy& liveVars);
 
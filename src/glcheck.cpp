@@ -17,7 +17,9 @@
 
 #include <unordered_set>
 
+#include "analyses.h"
 #include "symbols.h"
+#include "tools.h"
 
 using namespace llvm;
 
@@ -57,17 +59,10 @@ bool isStructureWithSEXPFields(Type *t) {
   return containsSEXP(t, visited);
 }
 
-int main(int argc, char* argv[])
-{
-  LLVMContext context;
-  FunctionsOrderedSetTy functionsOfInterestSet;
-  FunctionsVectorTy functionsOfInterestVector;
-  
-  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);
+static int runGlcheck(Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
     // NOTE: functionsOfInterest ignored but (re-)analyzing the R core is necessary
   
-  SymbolsMapTy symbolsMap;
-  findSymbols(m, &symbolsMap); // symbols are globals which hold SEXPs, but are safe
+  SymbolsMapTy& symbolsMap = *getModuleAnalyses(m)->getSymbolsMap(); // symbols are globals which hold SEXPs, but are safe
   
   for(Module::global_iterator gi = m->global_begin(), ge = m->global_end(); gi != ge ; ++gi) {
     GlobalVariable *gv = &*gi;
@@ -87,5 +82,14 @@ int main(int argc, char* argv[])
     }
   }
   
-  delete m;
+  return 0;
+}
+
+const ToolTy glcheckTool = { "glcheck", NULL, runGlcheck };
+
+#ifndef RCHK_DRIVER
+int main(int argc, char* argv[])
+{
+  return runTool(argc, argv, glcheckTool);
 }
+#endif
@@ -3,6 +3,8 @@
 #include "patterns.h"
 #include "vectors.h"
 
+#include <algorithm>
+
 #include <llvm/IR/CallSite.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/GlobalVariable.h>
@@ -21,7 +23,7 @@ using namespace llvm;
 //   [in other cases, we would gain nothing by tracking the guard]
 //
 // these heuristics are important because the keep the state space small(er)
-static bool isIntegerGuardVariable(AllocaInst* var) {
+bool isIntGuardVariable(AllocaInst* var) {
 
   if (!IntegerType::classof(var->getAllocatedType()) || var->isArrayAllocation()) {
     return false;
@@ -80,15 +82,7 @@ static bool isIntegerGuardVariable(AllocaInst* var) {
 }
 
 bool IntGuardsChecker::isGuard(AllocaInst* var) {
-  auto csearch = varsCache.find(var);
-  if (csearch != varsCache.end()) {
-    return csearch->second;
-  }
-
-  bool res = isIntegerGuardVariable(var);
-  
-  varsCache.insert({var, res});
-  return res;
+  return vars->is(var, VK_INT_GUARD);
 }
 
 std::string igs_name(IntGuardState gs) {
@@ -151,7 +145,7 @@ void IntGuardsChecker::handleForNonTerminator(Instruction *in, IntGuardsTy& intG
       if (msg->debug()) msg->debug("integer guard variable " + varName(storePointerVar) + " (set to) unknown", store);
     } 
   }
-  intGuards[storePointerVar] = newState;
+  intGuards.set(storePointerVar, newState);
 }
 
 bool IntGuardsChecker::handleForTerminator(TerminatorInst* t, StateWithGuardsTy& s) {
@@ -224,7 +218,7 @@ bool IntGuardsChecker::handleForTerminator(TerminatorInst* t, StateWithGuardsTy&
     // true branch is possible
     {
       StateWithGuardsTy* state = s.clone(branch->getSuccessor(0));
-      state->intGuards[var] = ci->isTrueWhenEqual() ? IGS_ZERO : IGS_NONZERO;
+      state->intGuards.set(var, ci->isTrueWhenEqual() ? IGS_ZERO : IGS_NONZERO);
       if (state->add()) {
         msg->trace("added true branch on integer guard of branch at", branch);
       }
@@ -234,7 +228,7 @@ bool IntGuardsChecker::handleForTerminator(TerminatorInst* t, StateWithGuardsTy&
     // false branch is possible
     {
       StateWithGuardsTy* state = s.clone(branch->getSuccessor(1));
-      state->intGuards[var] = ci->isTrueWhenEqual() ? IGS_NONZERO : IGS_ZERO;
+      state->intGuards.set(var, ci->isTrueWhenEqual() ? IGS_NONZERO : IGS_ZERO);
       if (state->add()) {
         msg->trace("added false branch on integer guard of branch at", branch);
       }
@@ -245,29 +239,21 @@ bool IntGuardsChecker::handleForTerminator(TerminatorInst* t, StateWithGuardsTy&
 
 PackedIntGuardsTy IntGuardsChecker::pack(const IntGuardsTy& intGuards) {
 
-  // note we first have to call indexOf on each variable to make sure
-  // it is indexed [later this should be perhaps done alreading when manipulating guards]
-  
-  for(IntGuardsTy::const_iterator gi = intGuards.begin(), ge = intGuards.end(); gi != ge; ++gi) {
-    AllocaInst* var = gi->first;
-    varIndex.indexOf(var);
-  }  
-
-  PackedIntGuardsTy packed(varIndex.size());
+  PackedIntGuardsTy packed(vars->nIntGuards());
   
   for(IntGuardsTy::const_iterator gi = intGuards.begin(), ge = intGuards.end(); gi != ge; ++gi) {
     AllocaInst* var = gi->first;
     IntGuardState gs = gi->second;
     
-    unsigned varIdx = varIndex.indexOf(var);
-    unsigned base = varIdx * IGS_BITS;
+    unsigned varIdx = vars->intGuardIndex(var);
+    myassert(varIdx != NOT_A_GUARD);
     
     switch(gs) {
-      case IGS_NONZERO: packed.bits[base] = true; break;     // 1 0
-      case IGS_ZERO:    packed.bits[base + 1] = true; break; // 0 1
-      case IGS_UNKNOWN: break;                               // implied 0 0
+      case IGS_NONZERO: packed.fields.set(varIdx, 1); break;
+      case IGS_ZERO:    packed.fields.set(varIdx, 2); break;
+      case IGS_UNKNOWN: break;                          // implied 0
     }
-    // 0 0 means UNKNOWN (or not included)
+    // 0 means UNKNOWN (or not included)
   }
 
   return packed;
@@ -275,37 +261,33 @@ PackedIntGuardsTy IntGuardsChecker::pack(const IntGuardsTy& intGuards) {
 
 IntGuardsTy IntGuardsChecker::unpack(const PackedIntGuardsTy& intGuards) {
 
+  typedef PackedIntGuardsTy::FieldsTy FieldsTy;
+
   IntGuardsTy unpacked;
-  unsigned nvars = intGuards.bits.size() / IGS_BITS;
-  
-  myassert(nvars * IGS_BITS == intGuards.bits.size());
+  const FieldsTy& fields = intGuards.fields;
   
-  for(unsigned varIdx = 0; varIdx < nvars; varIdx++) {
-    unsigned base = varIdx * IGS_BITS;
-    IntGuardState gs = IGS_UNKNOWN;
-    
-    if (intGuards.bits[base]) {
-      gs = IGS_NONZERO;  
-    } else if (intGuards.bits[base + 1]) {
-      gs = IGS_ZERO;
+  for(unsigned w = 0, nw = fields.words.size(); w < nw; w++) {
+    if (!fields.words[w]) {
+      continue; // no known state in this word
     }
+    for(unsigned varIdx = w * FieldsTy::FIELDS_PER_WORD, ve = varIdx + FieldsTy::FIELDS_PER_WORD; varIdx < ve; varIdx++) {
+      IntGuardState gs = IGS_UNKNOWN;
+      
+      switch(fields.get(varIdx)) {
+        case 1: gs = IGS_NONZERO; break;
+        case 2: gs = IGS_ZERO; break;
+      }
     
-    if (gs != IGS_UNKNOWN) {
-      unpacked.insert({varIndex.at(varIdx), gs});
+      if (gs != IGS_UNKNOWN) {
+        unpacked.insert({vars->intGuard(varIdx), gs});
+      }
     }
   }
   return unpacked;
 }
   
 void IntGuardsChecker::hash(size_t& res, const IntGuardsTy& intGuards) {
-
-  hash_combine(res, intGuards.size());
-  for(IntGuardsTy::const_iterator gi = intGuards.begin(), ge = intGuards.end(); gi != ge; ++gi) {
-    AllocaInst* var = gi->first;
-    IntGuardState s = gi->second;
-    hash_combine(res, (void *)var);
-    hash_combine(res, (size_t) s);
-  } // ordered map
+  hash_combine(res, intGuards.hash()); // maintained incrementally
 }
 
 // SEXP guard is a local variable of type SEXP
@@ -314,7 +296,7 @@ void IntGuardsChecker::hash(size_t& res, const IntGuardsTy& intGuards) {
 //   but also they are fragile - if something important is not a guard, the results will be less
 //     precise, may have more false alarms
 
-bool SEXPGuardsChecker::uncachedIsGuard(AllocaInst* var) {
+bool isSEXPGuardVariable(AllocaInst* var, const GlobalsTy* g) {
   if (!isSEXP(var)) {
     return false;
   }
@@ -407,39 +389,31 @@ bool SEXPGuardsChecker::uncachedIsGuard(AllocaInst* var) {
 }
 
 bool SEXPGuardsChecker::isGuard(AllocaInst* var) {
-  auto csearch = varsCache.find(var);
-  if (csearch != varsCache.end()) {
-    return csearch->second;
-  }
-
-  bool res = uncachedIsGuard(var);
-  
-  varsCache.insert({var, res});
-  return res;
+  return vars->is(var, VK_SEXP_GUARD);
 }
 
-std::string sgs_name(SEXPGuardTy& g) {
+std::string sgs_name(const SEXPGuardTy& g) {
 
   SEXPGuardState sgs = g.state;
   switch(sgs) {
     case SGS_NIL: return "nil (R_NilValue)";
     case SGS_NONNIL: return "non-nil (not R_NilValue)";
     case SGS_UNKNOWN: return "unknown";
-    case SGS_SYMBOL: return "symbol \"" + g.symbolName + "\"";
+    case SGS_SYMBOL: return "symbol \"" + g.getSymbolName() + "\"";
     case SGS_VECTOR: return "vector";
   }
   myassert(false);
   return "internal-error";
 }
 
-SEXPGuardState SEXPGuardsChecker::getGuardState(const SEXPGuardsTy& sexpGuards, AllocaInst* var, std::string& symbolName) {
+SEXPGuardState SEXPGuardsChecker::getGuardState(const SEXPGuardsTy& sexpGuards, AllocaInst* var, SymbolIdTy& symbol) {
   auto gsearch = sexpGuards.find(var);
   if (gsearch == sexpGuards.end()) {
     return SGS_UNKNOWN;
   } else {
     SEXPGuardState gs = gsearch->second.state;
     if (gs == SGS_SYMBOL) {
-      symbolName = gsearch->second.symbolName;
+      symbol = gsearch->second.symbol;
     }
     return gs;
   }
@@ -464,7 +438,7 @@ void SEXPGuardsChecker::handleForNonTerminator(Instruction* in, SEXPGuardsTy& se
     SEXPGuardState gs = getGuardState(sexpGuards, vvar);
     if (gs != SGS_VECTOR) {
       SEXPGuardTy newGS(SGS_VECTOR);
-      sexpGuards[vvar] = newGS;
+      sexpGuards.set(vvar, newGS);
       if (msg->debug()) msg->debug("sexp guard variable " + varName(vvar) + " set to vector because used with vector-only operation", in);
     }
     return;
@@ -501,15 +475,15 @@ void SEXPGuardsChecker::handleForNonTerminator(Instruction* in, SEXPGuardsTy& se
     Argument *arg = cast<Argument>(storeValueOp);
     const ArgInfoTy *ai = (*argInfos)[arg->getArgNo()];
     if (ai && ai->isSymbol()) { // sexpguard = symbol_argument
-      SEXPGuardTy newGS(SGS_SYMBOL, static_cast<const SymbolArgInfoTy*>(ai)->symbolName);
-      sexpGuards[storePointerVar] = newGS;
+      SEXPGuardTy newGS(SGS_SYMBOL, static_cast<const SymbolArgInfoTy*>(ai)->symbol);
+      sexpGuards.set(storePointerVar, newGS);
       if (msg->debug()) msg->debug("sexp guard variable " + varName(storePointerVar) + " set to symbol \"" +
-        static_cast<const SymbolArgInfoTy*>(ai)->symbolName + "\" from argument", store);
+        newGS.getSymbolName() + "\" from argument", store);
       return;
     }
     if (ai && ai->isVector()) { // sexpguard = vector_argument
       SEXPGuardTy newGS(SGS_VECTOR);
-      sexpGuards[storePointerVar] = newGS;
+      sexpGuards.set(storePointerVar, newGS);
       if (msg->debug()) msg->debug("sexp guard variable " + varName(storePointerVar) + " set to vector from argument", store);
       return;
     }
@@ -520,7 +494,7 @@ void SEXPGuardsChecker::handleForNonTerminator(Instruction* in, SEXPGuardsTy& se
     if (src == g->nilVariable) {  // sexpguard = R_NilValue
       if (msg->debug()) msg->debug("sexp guard variable " + varName(storePointerVar) + " set to nil", store);
       SEXPGuardTy newGS(SGS_NIL);
-      sexpGuards[storePointerVar] = newGS;
+      sexpGuards.set(storePointerVar, newGS);
       return;
     }
     if (AllocaInst::classof(src) && 
@@ -532,7 +506,7 @@ void SEXPGuardsChecker::handleForNonTerminator(Instruction* in, SEXPGuardsTy& se
         if (msg->debug()) msg->debug("sexp guard variable " + varName(storePointerVar) + " set to unknown state because " +
           varName(cast<AllocaInst>(src)) + " is also unknown.", store);
       } else {
-        sexpGuards[storePointerVar] = gsearch->second;
+        sexpGuards.set(storePointerVar, gsearch->second);
         if (msg->debug()) msg->debug("sexp guard variable " + varName(storePointerVar) + " set to state of " +
           varName(cast<AllocaInst>(src)) + ", which is " + sgs_name(gsearch->second), store);
       }
@@ -542,8 +516,8 @@ void SEXPGuardsChecker::handleForNonTerminator(Instruction* in, SEXPGuardsTy& se
       auto sfind = symbolsMap->find(cast<GlobalVariable>(src));
       if (sfind != symbolsMap->end()) {
         SEXPGuardTy newGS(SGS_SYMBOL, sfind->second);
-        sexpGuards[storePointerVar] = newGS;
-        if (msg->debug()) msg->debug("sexp guard variable " + varName(storePointerVar) + " set to symbol \"" + sfind->second + "\" at assignment", store);
+        sexpGuards.set(storePointerVar, newGS);
+        if (msg->debug()) msg->debug("sexp guard variable " + varName(storePointerVar) + " set to symbol \"" + newGS.getSymbolName() + "\" at assignment", store);
         return;
       } 
     }
@@ -553,17 +527,17 @@ void SEXPGuardsChecker::handleForNonTerminator(Instruction* in, SEXPGuardsTy& se
 
     if (acs && isVectorProducingCall(storeValueOp, cm, this, &sexpGuards)) {
       SEXPGuardTy newGS(SGS_VECTOR);
-      sexpGuards[storePointerVar] = newGS;
+      sexpGuards.set(storePointerVar, newGS);
       if (msg->debug()) msg->debug("sexp guard variable " + varName(storePointerVar) + " set to vector (created by " + funName(atgt) +  ")", store);
       return;
     }
 
     if (acs) {
-      std::string symbolName;
-      if (isInstallConstantCall(storeValueOp, symbolName)) {
-        SEXPGuardTy newGS(SGS_SYMBOL, symbolName);
-        sexpGuards[storePointerVar] = newGS;
-        if (msg->debug()) msg->debug("sexp guard variable " + varName(storePointerVar) + " set to symbol \"" + symbolName + "\" at install call " + funName(atgt), store);
+      SymbolIdTy symbol;
+      if (isInstallConstantCall(storeValueOp, symbol)) {
+        SEXPGuardTy newGS(SGS_SYMBOL, symbol);
+        sexpGuards.set(storePointerVar, newGS);
+        if (msg->debug()) msg->debug("sexp guard variable " + varName(storePointerVar) + " set to symbol \"" + newGS.getSymbolName() + "\" at install call " + funName(atgt), store);
         return;        
       }
     }
@@ -572,7 +546,7 @@ void SEXPGuardsChecker::handleForNonTerminator(Instruction* in, SEXPGuardsTy& se
       Function *afun = acs.getCalledFunction();
       if (possibleAllocators->find(afun) != possibleAllocators->end()) {
         SEXPGuardTy newGS(SGS_NONNIL);
-        sexpGuards[storePointerVar] = newGS;
+        sexpGuards.set(storePointerVar, newGS);
         if (msg->debug()) msg->debug("sexp guard variable " + varName(storePointerVar) + " set to non-nill (allocated by " + funName(atgt) + ")", store);
         return;
       }
@@ -622,7 +596,7 @@ bool SEXPGuardsChecker::handleNullCheck(bool positive, SEXPGuardState gs, Alloca
       StateWithGuardsTy* state = s.clone(branch->getSuccessor(0));
       if (gs != SGS_SYMBOL && gs != SGS_VECTOR) {
         SEXPGuardTy newGS(positive ? SGS_NIL : SGS_NONNIL);
-        state->sexpGuards[guard] = newGS; // added information from that the true branch was taken
+        state->sexpGuards.set(guard, newGS); // added information from that the true branch was taken
       }
       if (state->add()) {
         msg->trace("added true branch on sexp guard of branch at", branch);
@@ -635,7 +609,7 @@ bool SEXPGuardsChecker::handleNullCheck(bool positive, SEXPGuardState gs, Alloca
       StateWithGuardsTy* state = s.clone(branch->getSuccessor(1));
       if (gs != SGS_SYMBOL && gs != SGS_VECTOR) {
         SEXPGuardTy newGS(positive ? SGS_NONNIL : SGS_NIL);
-        state->sexpGuards[guard] = newGS; // added information from that the false branch was taken
+        state->sexpGuards.set(guard, newGS); // added information from that the false branch was taken
       }
       if (state->add()) {
         msg->trace("added false branch on sexp guard of branch at", branch);
@@ -720,7 +694,7 @@ bool SEXPGuardsChecker::handleTypeCheck(bool positive, int testedType, SEXPGuard
       StateWithGuardsTy* state = s.clone(branch->getSuccessor(0)); // FIXME: capture that something is a symbol even if we don't know which one
       if (gs != SGS_SYMBOL && gs != SGS_VECTOR && isVectorType(testedType) && positive) {
         SEXPGuardTy newGS(SGS_VECTOR);
-        state->sexpGuards[guard] = newGS; // added information from that the true branch was taken (e.g. if it is a String, it is definitely a vector)
+        state->sexpGuards.set(guard, newGS); // added information from that the true branch was taken (e.g. if it is a String, it is definitely a vector)
       }      
       if (state->add()) {
         msg->trace("added true type branch on sexp guard of branch at", branch);
@@ -792,7 +766,7 @@ bool SEXPGuardsChecker::handleTypeSwitch(TerminatorInst* t, StateWithGuardsTy& s
       StateWithGuardsTy* state = s.clone(succ);
       if (newgs != gs) {
         SEXPGuardTy ng(newgs);
-        state->sexpGuards[var] = ng;
+        state->sexpGuards.set(var, ng);
       }
 
       if (state->add()) {
@@ -911,7 +885,7 @@ bool SEXPGuardsChecker::handleForTerminator(TerminatorInst* t, StateWithGuardsTy
         StateWithGuardsTy* state = s.clone(branch->getSuccessor(0));
         if (gs != SGS_SYMBOL && impliesVectorWhenTrue(f)) {
           SEXPGuardTy newGS(SGS_VECTOR);
-          state->sexpGuards[guard] = newGS; // added information from that the true branch was taken
+          state->sexpGuards.set(guard, newGS); // added information from that the true branch was taken
         }
         if (state->add()) {
           msg->trace("added (also) true branch on sexp guard (vector) of branch at", branch);
@@ -921,7 +895,7 @@ bool SEXPGuardsChecker::handleForTerminator(TerminatorInst* t, StateWithGuardsTy
         StateWithGuardsTy* state = s.clone(branch->getSuccessor(1));
         if (gs != SGS_SYMBOL && impliesVectorWhenFalse(f)) {
           SEXPGuardTy newGS(SGS_VECTOR);
-          state->sexpGuards[guard] = newGS; // added information from that the true branch was taken
+          state->sexpGuards.set(guard, newGS); // added information from that the true branch was taken
         }
         if (state->add()) {
           msg->trace("added (also) false branch on sexp guard (vector) of branch at", branch);
@@ -954,8 +928,8 @@ bool SEXPGuardsChecker::handleForTerminator(TerminatorInst* t, StateWithGuardsTy
     return false;
   }
   
-  std::string guardSymbolName;
-  SEXPGuardState gs = getGuardState(s.sexpGuards, guard, guardSymbolName);
+  SymbolIdTy guardSymbol;
+  SEXPGuardState gs = getGuardState(s.sexpGuards, guard, guardSymbol);
   int succIndex = -1;
 
   if (gv == g->nilVariable) {
@@ -978,7 +952,7 @@ bool SEXPGuardsChecker::handleForTerminator(TerminatorInst* t, StateWithGuardsTy
     return false;
   }
       
-  const std::string& constSymbolName = sfind->second;
+  SymbolIdTy constSymbol = sfind->second;
 
   // if (x == R_XSymbol) ...
   // if (x != R_XSymbol) ...
@@ -986,10 +960,10 @@ bool SEXPGuardsChecker::handleForTerminator(TerminatorInst* t, StateWithGuardsTy
   if (gs == SGS_SYMBOL) {
     if (ci->isTrueWhenEqual()) {
       // guard == R_XSymbol
-      succIndex = (guardSymbolName == constSymbolName) ? 0 : 1;
+      succIndex = (guardSymbol == constSymbol) ? 0 : 1;
     } else {
       // guard != R_XSymbol
-      succIndex = (guardSymbolName == constSymbolName) ? 1 : 0;
+      succIndex = (guardSymbol == constSymbol) ? 1 : 0;
     }
   }
   if (gs == SGS_NIL || gs == SGS_VECTOR) {  // SGS_NIL and SGS_VECTOR cannot be a symbol
@@ -1021,8 +995,8 @@ bool SEXPGuardsChecker::handleForTerminator(TerminatorInst* t, StateWithGuardsTy
     {
       StateWithGuardsTy* state = s.clone(branch->getSuccessor(0));
       if (gs != SGS_SYMBOL && ci->isTrueWhenEqual()) {
-        SEXPGuardTy newGS(SGS_SYMBOL, constSymbolName);
-        state->sexpGuards[guard] = newGS;
+        SEXPGuardTy newGS(SGS_SYMBOL, constSymbol);
+        state->sexpGuards.set(guard, newGS);
       }
       if (state->add()) {
         msg->trace("added true branch on sexp guard of symbol branch at", branch);
@@ -1034,8 +1008,8 @@ bool SEXPGuardsChecker::handleForTerminator(TerminatorInst* t, StateWithGuardsTy
     {
       StateWithGuardsTy* state = s.clone(branch->getSuccessor(1));
       if (gs != SGS_SYMBOL && ci->isFalseWhenEqual()) {
-        SEXPGuardTy newGS(SGS_SYMBOL, constSymbolName);
-        state->sexpGuards[guard] = newGS;
+        SEXPGuardTy newGS(SGS_SYMBOL, constSymbol);
+        state->sexpGuards.set(guard, newGS);
       }
       if (state->add()) {
         msg->trace("added false branch on sexp guard of branch at", branch);
@@ -1047,94 +1021,73 @@ bool SEXPGuardsChecker::handleForTerminator(TerminatorInst* t, StateWithGuardsTy
   
 PackedSEXPGuardsTy SEXPGuardsChecker::pack(const SEXPGuardsTy& sexpGuards) {
 
-  // note we first have to call indexOf on each variable to make sure
-  // it is indexed [later this should be perhaps done alreading when manipulating guards]
+  PackedSEXPGuardsTy packed(vars->nSEXPGuards());
+  std::vector<std::pair<unsigned, SymbolIdTy>> symbols;
   
   for(SEXPGuardsTy::const_iterator gi = sexpGuards.begin(), ge = sexpGuards.end(); gi != ge; ++gi) {
     AllocaInst* var = gi->first;
-    varIndex.indexOf(var);
-  }  
-  
-  PackedSEXPGuardsTy packed(varIndex.size());
-  
-  const VarIndexTy::Index& vars = varIndex.getIndex();
-  unsigned idx = 0;
-  
-  // store variables in the order of varIndex, so that symbol names in the list of symbols
-  //   can be mapped back to variables
-  for(VarIndexTy::Index::const_iterator vi = vars.begin(), ve = vars.end(); vi != ve; ++vi, ++idx) {
-    AllocaInst *var = *vi;
-    
-    auto vfind = sexpGuards.find(var);
-    if (vfind == sexpGuards.end()) {
-      continue;
-    }
-    const SEXPGuardTy& guard = vfind->second;
-    SEXPGuardState gs = guard.state;
+    const SEXPGuardTy& guard = gi->second;
     
-    unsigned base = idx * SGS_BITS;
-    switch(gs) {
-      case SGS_NIL:    packed.bits[base] = true; break;     // 1 0 0
-      case SGS_NONNIL: packed.bits[base + 1] = true; break; // 0 1 0
-      case SGS_SYMBOL: packed.bits[base] = true; packed.bits[base + 1] = true; // 1 1 0
-                       packed.symbols.push_back(guard.symbolName);
-                       break;
-      case SGS_VECTOR: packed.bits[base + 2] = true; break;     // 0 0 1
-      case SGS_UNKNOWN: break; // 0 0 0
+    unsigned idx = vars->sexpGuardIndex(var);
+    myassert(idx != NOT_A_GUARD);
+    switch(guard.state) {
+      case SGS_NIL:     packed.fields.set(idx, 1); break;
+      case SGS_NONNIL:  packed.fields.set(idx, 2); break;
+      case SGS_SYMBOL:  packed.fields.set(idx, 3);
+                        symbols.push_back({idx, guard.symbol});
+                        break;
+      case SGS_VECTOR:  packed.fields.set(idx, 4); break;
+      case SGS_UNKNOWN: break; // 0
     }
   }
 
+  // store symbols in the order of the variable index, so that they can be
+  //   mapped back to variables
+  std::sort(symbols.begin(), symbols.end());
+  for(std::vector<std::pair<unsigned, SymbolIdTy>>::iterator si = symbols.begin(), se = symbols.end(); si != se; ++si) {
+    packed.symbols.push_back(si->second);
+  }
+
   return packed;
 }
 
 SEXPGuardsTy SEXPGuardsChecker::unpack(const PackedSEXPGuardsTy& sexpGuards) {
+
+  typedef PackedSEXPGuardsTy::FieldsTy FieldsTy;
+
   SEXPGuardsTy unpacked;
-  unsigned nvars = sexpGuards.bits.size() / SGS_BITS;
-  
-  myassert(nvars * SGS_BITS == sexpGuards.bits.size());
+  const FieldsTy& fields = sexpGuards.fields;
   unsigned symbolIdx = 0;
   
-  for(unsigned idx = 0; idx < nvars; idx++) {
-    unsigned base = idx * SGS_BITS;
-    SEXPGuardState gs = SGS_UNKNOWN;
-    std::string symbolName;
-    
-    bool bit2 = sexpGuards.bits[base];
-    bool bit1 = sexpGuards.bits[base + 1];
-    bool bit0 = sexpGuards.bits[base + 2];
+  for(unsigned w = 0, nw = fields.words.size(); w < nw; w++) {
+    if (!fields.words[w]) {
+      continue; // no known state in this word
+    }
+    for(unsigned idx = w * FieldsTy::FIELDS_PER_WORD, ie = idx + FieldsTy::FIELDS_PER_WORD; idx < ie; idx++) {
+      SEXPGuardState gs = SGS_UNKNOWN;
+      SymbolIdTy symbol = 0;
     
-    if (bit2) {
-      if (bit1) {
-        gs = SGS_SYMBOL;
-        symbolName = sexpGuards.symbols[symbolIdx];
-        symbolIdx++;
-      } else {
-        gs = SGS_NIL;
+      switch(fields.get(idx)) {
+        case 1: gs = SGS_NIL; break;
+        case 2: gs = SGS_NONNIL; break;
+        case 3: gs = SGS_SYMBOL;
+                symbol = sexpGuards.symbols[symbolIdx];
+                symbolIdx++;
+                break;
+        case 4: gs = SGS_VECTOR; break;
       }
-    } else {
-      if (bit1) {
-        gs = SGS_NONNIL;
-      } else if (bit0) {
-        gs = SGS_VECTOR;
-      }
-    }
     
-    if (gs != SGS_UNKNOWN) {
-      unpacked.insert({varIndex.at(idx), SEXPGuardTy(gs, symbolName)});
+      if (gs != SGS_UNKNOWN) {
+        unpacked.insert({vars->sexpGuard(idx), SEXPGuardTy(gs, symbol)});
+      }
     }
   }
+  myassert(symbolIdx == sexpGuards.symbols.size());
   return unpacked;
 }
   
 void SEXPGuardsChecker::hash(size_t& res, const SEXPGuardsTy& sexpGuards) {
-  hash_combine(res, sexpGuards.size());
-  for(SEXPGuardsTy::const_iterator gi = sexpGuards.begin(), ge = sexpGuards.end(); gi != ge; ++gi) {
-    AllocaInst* var = gi->first;
-    const SEXPGuardTy& g = gi->second;
-    hash_combine(res, (void *) var);
-    hash_combine(res, (size_t) g.state);
-    hash_combine(res, g.symbolName);
-  } // ordered map
+  hash_combine(res, sexpGuards.hash()); // maintained incrementally
 }
 
 // common
@@ -1142,7 +1095,7 @@ void SEXPGuardsChecker::hash(size_t& res, const SEXPGuardsTy& sexpGuards) {
 void StateWithGuardsTy::dump(bool verbose) {
   
   errs() << "=== integer guards: " << &intGuards << "\n";
-  for(IntGuardsTy::iterator gi = intGuards.begin(), ge = intGuards.end(); gi != ge; ++gi) {
+  for(IntGuardsTy::const_iterator gi = intGuards.begin(), ge = intGuards.end(); gi != ge; ++gi) {
     AllocaInst *i = gi->first;
     IntGuardState s = gi->second;
     errs() << "   " << varName(i) << " ";
@@ -1153,9 +1106,9 @@ void StateWithGuardsTy::dump(bool verbose) {
   }
 
   errs() << "=== sexp guards: " << &sexpGuards << "\n";
-  for(SEXPGuardsTy::iterator gi = sexpGuards.begin(), ge = sexpGuards.end(); gi != ge; ++gi) {
+  for(SEXPGuardsTy::const_iterator gi = sexpGuards.begin(), ge = sexpGuards.end(); gi != ge; ++gi) {
     AllocaInst *i = gi->first;
-    SEXPGuardTy &g = gi->second;
+    const SEXPGuardTy &g = gi->second;
     
     errs() << "   " << varName(i) << " ";
     if (verbose) {
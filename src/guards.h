@@ -4,17 +4,24 @@
 #include <map>
 #include <unordered_set>
 
+#include <llvm/ADT/Hashing.h>
 #include <llvm/IR/Instructions.h>
 
+#include "hashed.h"
+#include "packed.h"
+#include "region.h"
+
 using namespace llvm;
 
 struct SEXPGuardTy; // there is a cyclic dependency between guards.h and vectors.h
-typedef std::map<AllocaInst*,SEXPGuardTy> SEXPGuardsTy;
+struct SEXPGuardTy_entryHash;
+typedef HashedMap<AllocaInst*,SEXPGuardTy,SEXPGuardTy_entryHash,RegionAllocator<std::pair<AllocaInst* const,SEXPGuardTy>>> SEXPGuardsTy;
 class SEXPGuardsChecker;
 
 #include "common.h"
 #include "callocators.h"
 #include "linemsg.h"
+#include "localvars.h"
 #include "state.h"
 #include "symbols.h"
 #include "table.h"
@@ -29,32 +36,38 @@ enum IntGuardState {
 };
 const unsigned IGS_BITS = 2;
 
-typedef std::map<AllocaInst*,IntGuardState> IntGuardsTy;
+struct IntGuardState_entryHash {
+  size_t operator()(AllocaInst* var, IntGuardState s) const {
+    return hash_combine(var, (int) s);
+  }
+};
+
+typedef HashedMap<AllocaInst*,IntGuardState,IntGuardState_entryHash,RegionAllocator<std::pair<AllocaInst* const,IntGuardState>>> IntGuardsTy;
+  // guards are part of checking states, hence the region allocator
 
 struct PackedIntGuardsTy {
 
-  typedef std::vector<bool> BitsTy;
-  BitsTy bits;
+  typedef PackedFieldsTy<IGS_BITS> FieldsTy; // 0 unknown, 1 non-zero, 2 zero
+  FieldsTy fields;
   
-  PackedIntGuardsTy(unsigned nvars) : bits(nvars * IGS_BITS) {};
-  bool operator==(const PackedIntGuardsTy& other) const { return bits == other.bits; };
+  PackedIntGuardsTy(unsigned nvars) : fields(nvars) {};
+  bool operator==(const PackedIntGuardsTy& other) const { return fields == other.fields; };
 };
 
 struct StateWithGuardsTy;
 
 std::string igs_name(IntGuardState igs);
 
+bool isIntGuardVariable(AllocaInst* var);
+
 // per-function state for checking SEXP guards
 class IntGuardsChecker {
 
-  typedef IndexedTable<AllocaInst> VarIndexTy; // index of guard variables known so far
-
-  VarIndexTy varIndex;
-  VarBoolCacheTy varsCache; // FIXME: could eagerly search all variables and merge var cache with index
+  const FunctionVarsTy* vars; // guard variables and their index
   LineMessenger* msg;
 
   public:
-    IntGuardsChecker(LineMessenger* msg): varIndex(), varsCache(), msg(msg) {};
+    IntGuardsChecker(LineMessenger* msg, const FunctionVarsTy* vars): vars(vars), msg(msg) {};
 
     PackedIntGuardsTy pack(const IntGuardsTy& intGuards);
     IntGuardsTy unpack(const PackedIntGuardsTy& intGuards);
@@ -67,7 +80,6 @@ class IntGuardsChecker {
     IntGuardState getGuardState(const IntGuardsTy& intGuards, AllocaInst* var);
 
     void reset(Function *f) {};    
-    void clear() { varsCache.clear(); } // FIXME: get rid of this
 };
 
 
@@ -75,50 +87,55 @@ class IntGuardsChecker {
 
 enum SEXPGuardState {
   SGS_NIL = 0, // R_NilValue
-  SGS_SYMBOL,  // A specific symbol, name stored in symbolName
+  SGS_SYMBOL,  // A specific symbol, id stored in symbol
   SGS_VECTOR,  // Anything that LENGTH can be called on (includes numeric vectors, generic vectors, but not things implemented as pair-lists) 
   SGS_NONNIL,
   SGS_UNKNOWN
 };
-const unsigned SGS_BITS = 3;
+const unsigned SGS_BITS = 4; // 3 are used, 4 so that fields do not span words
 
 struct SEXPGuardTy {
   SEXPGuardState state;
-  std::string symbolName;
+  SymbolIdTy symbol; // only valid for SGS_SYMBOL
   
-  SEXPGuardTy(SEXPGuardState state, const std::string& symbolName): state(state), symbolName(symbolName) {}
-  SEXPGuardTy(SEXPGuardState state): state(state), symbolName() { assert(state != SGS_SYMBOL); }
+  SEXPGuardTy(SEXPGuardState state, SymbolIdTy symbol): state(state), symbol(symbol) {}
+  SEXPGuardTy(SEXPGuardState state): state(state), symbol(0) { assert(state != SGS_SYMBOL); }
   SEXPGuardTy() : SEXPGuardTy(SGS_UNKNOWN) {};
   
-  bool operator==(const SEXPGuardTy& other) const { return state == other.state && (state != SGS_SYMBOL || symbolName == other.symbolName); };
-  
+  bool operator==(const SEXPGuardTy& other) const { return state == other.state && (state != SGS_SYMBOL || symbol == other.symbol); };
+  const std::string& getSymbolName() const { return ::getSymbolName(symbol); }
+};
+
+struct SEXPGuardTy_entryHash {
+  size_t operator()(AllocaInst* var, const SEXPGuardTy& g) const {
+    return hash_combine(var, (int) g.state, g.state == SGS_SYMBOL ? g.symbol : 0);
+  }
 };
 
 
 
 struct PackedSEXPGuardsTy {
 
-  typedef std::vector<bool> BitsTy;
-  BitsTy bits;
+  typedef PackedFieldsTy<SGS_BITS> FieldsTy; // 0 unknown, 1 nil, 2 non-nil, 3 symbol, 4 vector
+  FieldsTy fields;
   
-  typedef std::vector<std::string> SymbolsTy;
-  SymbolsTy symbols;
+  typedef std::vector<SymbolIdTy> SymbolsTy;
+  SymbolsTy symbols; // of variables in symbol state, in the order of their fields
   
-  PackedSEXPGuardsTy(unsigned nvars) : bits(nvars * SGS_BITS), symbols() {};
-  bool operator==(const PackedSEXPGuardsTy& other) const { return bits == other.bits && symbols == other.symbols; };
+  PackedSEXPGuardsTy(unsigned nvars) : fields(nvars), symbols() {};
+  bool operator==(const PackedSEXPGuardsTy& other) const { return fields == other.fields && symbols == other.symbols; };
 };
 
   // yikes, need forward type-def
 struct ArgInfoTy;
 typedef std::vector<const ArgInfoTy*> ArgInfosVectorTy;
 
+bool isSEXPGuardVariable(AllocaInst* var, const GlobalsTy* g);
+
 // per-function state for checking SEXP guards
 class SEXPGuardsChecker {
 
-  typedef IndexedTable<AllocaInst> VarIndexTy; // index of guard variables known so far
-
-  VarIndexTy varIndex;
-  VarBoolCacheTy varsCache; // FIXME: could eagerly search all variables and merge var cache with index
+  const FunctionVarsTy* vars; // guard variables and their index
   LineMessenger* msg;
   const GlobalsTy* g;
   const FunctionsSetTy* possibleAllocators;
@@ -128,9 +145,9 @@ class SEXPGuardsChecker {
   CalledModuleTy* cm; // FIXME: get rid of fields that are already in called module anyway
   
   public:
-    SEXPGuardsChecker(LineMessenger* msg, const GlobalsTy* g, const FunctionsSetTy* possibleAllocators, const SymbolsMapTy* symbolsMap, const ArgInfosVectorTy* argInfos,
-      VrfStateTy* vrfState, CalledModuleTy* cm):
-      varIndex(), varsCache(), msg(msg), g(g), possibleAllocators(possibleAllocators), symbolsMap(symbolsMap), argInfos(argInfos), vrfState(vrfState), cm(cm) {};
+    SEXPGuardsChecker(LineMessenger* msg, const FunctionVarsTy* vars, const GlobalsTy* g, const FunctionsSetTy* possibleAllocators, const SymbolsMapTy* symbolsMap,
+      const ArgInfosVectorTy* argInfos, VrfStateTy* vrfState, CalledModuleTy* cm):
+      vars(vars), msg(msg), g(g), possibleAllocators(possibleAllocators), symbolsMap(symbolsMap), argInfos(argInfos), vrfState(vrfState), cm(cm) {};
 
     PackedSEXPGuardsTy pack(const SEXPGuardsTy& sexpGuards);
     SEXPGuardsTy unpack(const PackedSEXPGuardsTy& sexpGuards);
@@ -141,15 +158,13 @@ class SEXPGuardsChecker {
     bool handleForTerminator(TerminatorInst* t, StateWithGuardsTy& s);
     
     SEXPGuardState getGuardState(const SEXPGuardsTy& sexpGuards, AllocaInst* var);
-    SEXPGuardState getGuardState(const SEXPGuardsTy& sexpGuards, AllocaInst* var, std::string& symbolName);
+    SEXPGuardState getGuardState(const SEXPGuardsTy& sexpGuards, AllocaInst* var, SymbolIdTy& symbol);
 
     void reset(Function *f) {};    
-    void clear() { varsCache.clear(); } // FIXME: get rid of this
     
     VrfStateTy* getVrfState() { return vrfState; }
     
   private:
-    bool uncachedIsGuard(AllocaInst* var);
     bool handleNullCheck(bool positive, SEXPGuardState gs, AllocaInst *guard, BranchInst* branch, StateWithGuardsTy& s);
     bool handleTypeCheck(bool positive, int testedType, SEXPGuardState gs, AllocaInst *guard, BranchInst* branch, StateWithGuardsTy& s);
     bool handleTypeSwitch(TerminatorInst* t, StateWithGuardsTy& s);
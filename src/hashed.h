@@ -0,0 +1,158 @@
+#ifndef RCHK_HASHED_H
+#define RCHK_HASHED_H
+
+#include "common.h"
+
+#include <map>
+#include <vector>
+
+#include <llvm/ADT/Hashing.h>
+
+// containers for components of checking states that maintain a hash of their
+// content incrementally (Zobrist-style)
+//
+//   the hash is the xor of hashes of the individual entries, so it is updated
+//   in constant time by each insertion, removal or update, and computing the
+//   hash of a state costs time proportional to how much it changed, not to
+//   its size
+//
+//   the content can only be modified through the container, iterators are
+//   constant
+
+template <
+  class Key,
+  class T,
+  class EntryHash,
+  class Allocator = std::allocator<std::pair<const Key, T>>
+
+> class HashedMap {
+
+  typedef std::map<Key, T, std::less<Key>, Allocator> Map;
+  Map map;
+  size_t entriesHash;
+
+  static size_t entryHash(const Key& k, const T& v) {
+    return EntryHash()(k, v);
+  }
+
+  public:
+    typedef typename Map::const_iterator const_iterator;
+    typedef const_iterator iterator;
+    typedef typename Map::value_type value_type;
+
+    HashedMap(): map(), entriesHash(0) {};
+
+    const_iterator begin() const { return map.begin(); }
+    const_iterator end() const { return map.end(); }
+    const_iterator find(const Key& k) const { return map.find(k); }
+    size_t size() const { return map.size(); }
+    bool empty() const { return map.empty(); }
+
+    // inserts or overwrites
+    void set(const Key& k, const T& v) {
+      typename Map::iterator it = map.lower_bound(k);
+      if (it != map.end() && !map.key_comp()(k, it->first)) {
+        entriesHash ^= entryHash(it->first, it->second);
+        it->second = v;
+      } else {
+        map.insert(it, value_type(k, v));
+      }
+      entriesHash ^= entryHash(k, v);
+    }
+
+    void set(const_iterator pos, const T& v) {
+      typename Map::iterator it = map.erase(pos, pos); // non-const iterator to pos
+      entriesHash ^= entryHash(it->first, it->second);
+      it->second = v;
+      entriesHash ^= entryHash(it->first, it->second);
+    }
+
+    std::pair<const_iterator, bool> insert(const value_type& e) {
+      std::pair<typename Map::iterator, bool> res = map.insert(e);
+      if (res.second) {
+        entriesHash ^= entryHash(e.first, e.second);
+      }
+      return res;
+    }
+
+    const_iterator erase(const_iterator pos) {
+      entriesHash ^= entryHash(pos->first, pos->second);
+      return map.erase(pos);
+    }
+
+    size_t erase(const Key& k) {
+      const_iterator it = map.find(k);
+      if (it == map.end()) {
+        return 0;
+      }
+      erase(it);
+      return 1;
+    }
+
+    void clear() {
+      map.clear();
+      entriesHash = 0;
+    }
+
+    size_t hash() const {
+      size_t res = entriesHash;
+      hash_combine(res, map.size());
+      return res;
+    }
+
+    bool operator==(const HashedMap& other) const { return entriesHash == other.entriesHash && map == other.map; }
+};
+
+// stack (only pushed and popped at the end), entries are hashed together with their position
+
+template <
+  class T,
+  class Allocator = std::allocator<T>
+
+> class HashedStack {
+
+  typedef std::vector<T, Allocator> Vector;
+  Vector vector;
+  size_t entriesHash;
+
+  static size_t entryHash(const T& v, size_t pos) {
+    return llvm::hash_combine(v, pos);
+  }
+
+  public:
+    typedef typename Vector::const_iterator const_iterator;
+    typedef const_iterator iterator;
+
+    HashedStack(): vector(), entriesHash(0) {};
+
+    const_iterator begin() const { return vector.begin(); }
+    const_iterator end() const { return vector.end(); }
+    size_t size() const { return vector.size(); }
+    bool empty() const { return vector.empty(); }
+    const T& back() const { return vector.back(); }
+
+    void push_back(const T& v) {
+      entriesHash ^= entryHash(v, vector.size());
+      vector.push_back(v);
+    }
+
+    void pop_back() {
+      entriesHash ^= entryHash(vector.back(), vector.size() - 1);
+      vector.pop_back();
+    }
+
+    void clear() {
+      vector.clear();
+      entriesHash = 0;
+    }
+
+    size_t hash() const {
+      size_t res = entriesHash;
+      hash_combine(res, vector.size());
+      return res;
+    }
+
+    bool operator==(const HashedStack& other) const { return entriesHash == other.entriesHash && vector == other.vector; }
+};
+
+#endif
@@ -3,9 +3,11 @@
 
 #include "common.h"
 
+#include "region.h"
 #include "table.h"
 
 #include <set>
+#include <vector>
 
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Instruction.h>
@@ -26,7 +28,8 @@ struct LineInfoTy {
     LineInfoTy(const std::string& kind, const std::string& message, const std::string& path, unsigned line): 
       kind(kind), message(message), path(path), line(line) {}
     
-    void print() const;
+    void print() const { print(outs()); }
+    void print(raw_ostream& out) const;
     bool operator==(const LineInfoTy& other) const {
       return kind == other.kind && message == other.message && path == other.path && line == other.line;
     }
@@ -44,7 +47,8 @@ struct LineInfoTy_equal {
   bool operator() (const LineInfoTy& lhs, const LineInfoTy& rhs) const;
 };
 
-typedef std::set<const LineInfoTy*, LineInfoTyPtr_compare> LineInfoPtrSetTy; // for ordering messages, uniqueness
+typedef std::set<const LineInfoTy*, LineInfoTyPtr_compare, RegionAllocator<const LineInfoTy*>> LineInfoPtrSetTy; // for ordering messages, uniqueness
+  // delayed messages are part of checking states, hence the region allocator
 typedef InterningTable<LineInfoTy, LineInfoTy_hash, LineInfoTy_equal> LineInfoTableTy; // for interning table (performance)
 
 class BaseLineMessenger {
@@ -85,11 +89,14 @@ class LineMessenger : public BaseLineMessenger {
   
   Function *lastFunction;
   std::string lastChecksName;
+  raw_ostream& out; // where messages are printed (a buffer when checking functions concurrently)
+  std::vector<const LineInfoTy*>* emittedLog; // when set, emitted messages are also appended here
 //  const LLVMContext& context;
   
   public:
-    LineMessenger(LLVMContext& context, bool _DEBUG, bool TRACE, bool UNIQUE_MSG):
-      BaseLineMessenger(_DEBUG, TRACE, UNIQUE_MSG), lineBuffer(), internTable(), lastFunction(NULL), lastChecksName() {};
+    LineMessenger(LLVMContext& context, bool _DEBUG, bool TRACE, bool UNIQUE_MSG, raw_ostream& out = outs()):
+      BaseLineMessenger(_DEBUG, TRACE, UNIQUE_MSG), lineBuffer(LineInfoTyPtr_compare(), LineInfoPtrSetTy::allocator_type((StateRegion *) NULL)),
+      internTable(), lastFunction(NULL), lastChecksName(), out(out), emittedLog(NULL) {};
 //      BaseLineMessenger(_DEBUG, TRACE, UNIQUE_MSG), lineBuffer(), internTable(), lastFunction(NULL), lastChecksName(), context(context)  {};
       
     void flush();
@@ -99,6 +106,7 @@ class LineMessenger : public BaseLineMessenger {
     
     const LineInfoTy* intern(const LineInfoTy& li); // intern (but do not emit)
     void emitInterned(const LineInfoTy* li); // emit line info interned in internTable
+    void logEmitted(std::vector<const LineInfoTy*>* log) { emittedLog = log; }
     
     virtual void emit(const LineInfoTy* li);
 };
@@ -125,7 +133,7 @@ struct DelayedLineMessenger : public BaseLineMessenger {
   bool operator==(const DelayedLineMessenger& other) const;
   virtual void emit(const LineInfoTy* li);
   size_t size() const { return delayedLineBuffer.size(); }
-  void print(const std::string& prefix);
+  void print(const std::string& prefix) const;
 };
 
 #endif
@@ -1,6 +1,8 @@
 
 #include "liveness.h"
-#include "table.h"
+
+#include <algorithm>
+#include <unordered_set>
 
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/CFG.h>
@@ -8,150 +10,190 @@
 
 using namespace llvm;
 
-typedef IndexedTable<AllocaInst> VarIndexTy;
+const unsigned WORD_BITS = 64;
 
-static VarIndexTy indexVariables(Function *f) {
+static inline bool testBit(const uint64_t* bits, unsigned i) {
+  return (bits[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+}
 
-  VarIndexTy varIndex;
-  
-  for(inst_iterator ii = inst_begin(*f), ie = inst_end(*f); ii != ie; ++ii) {
-    Instruction *in = &*ii;
-    if (AllocaInst* var = dyn_cast<AllocaInst>(in)) {
-      varIndex.indexOf(var);
+static inline void setBit(uint64_t* bits, unsigned i) {
+  bits[i / WORD_BITS] |= ((uint64_t) 1) << (i % WORD_BITS);
+}
+
+static inline void clearBit(uint64_t* bits, unsigned i) {
+  bits[i / WORD_BITS] &= ~(((uint64_t) 1) << (i % WORD_BITS));
+}
+
+// the first access to variable vi after the instruction, or NULL
+static const VarAccessTy* findAccess(const VarAccessTy* accesses, unsigned vi) {
+
+  for(const VarAccessTy* a = accesses; a->var != VarAccessTy::END_OF_BLOCK; ++a) {
+    if (a->var == vi) {
+      return a;
     }
   }
-  
-  return varIndex;
+  return NULL;
 }
-typedef std::vector<bool> VarMapTy;
 
-struct BlockStateTy {
-  VarMapTy usedAfter;
-  VarMapTy killedAfter;
-  
-  BlockStateTy(VarMapTy usedAfter, VarMapTy killedAfter): usedAfter(usedAfter), killedAfter(killedAfter) {};
-};
+bool VarsLiveness::isPossiblyUsed(AllocaInst* var) const {
+  int vi = live->indexOf(var);
+  if (vi < 0) {
+    return false;
+  }
+  const VarAccessTy* a = findAccess(accesses, vi);
+  return a ? a->load : testBit(possiblyUsedAtEnd, vi);
+}
 
-typedef std::unordered_map<BasicBlock*, BlockStateTy> BlockStatesTy;
-typedef std::unordered_set<BasicBlock*> BlockSetTy;
+bool VarsLiveness::isPossiblyKilled(AllocaInst* var) const {
+  int vi = live->indexOf(var);
+  if (vi < 0) {
+    return false;
+  }
+  const VarAccessTy* a = findAccess(accesses, vi);
+  return a ? !a->load : testBit(possiblyKilledAtEnd, vi);
+}
 
-static void applyInstruction(Instruction *in, VarMapTy& used, VarMapTy& killed, VarIndexTy& varIndex) {
+void LiveVarsTy::applyInstruction(Instruction *in, WordTy* used, WordTy* killed) const {
 
   if (StoreInst* si = dyn_cast<StoreInst>(in)) {
     if (AllocaInst* var = dyn_cast<AllocaInst>(si->getPointerOperand())) { // variable is killed
-      unsigned vi = varIndex.indexOf(var);
-      used[vi] = false;
-      killed[vi] = true;
+      unsigned vi = varIndex.at(var);
+      clearBit(used, vi);
+      setBit(killed, vi);
     }
   }
   if (LoadInst* li = dyn_cast<LoadInst>(in)) {
     if (AllocaInst* var = dyn_cast<AllocaInst>(li->getPointerOperand())) { // variable is used
-      unsigned vi = varIndex.indexOf(var);
-      used[vi] = true;
-      killed[vi] = false;
+      unsigned vi = varIndex.at(var);
+      setBit(used, vi);
+      clearBit(killed, vi);
     }
   }
 }
 
+typedef std::unordered_set<BasicBlock*> BlockSetTy;
+
 LiveVarsTy findLiveVariables(Function *f) {
 
-  VarIndexTy varIndex = indexVariables(f);
-  size_t nvars = varIndex.size();
-  
-  BlockStatesTy blockStates;
+  LiveVarsTy live;
+
+  for(inst_iterator ii = inst_begin(*f), ie = inst_end(*f); ii != ie; ++ii) {
+    Instruction *in = &*ii;
+    if (AllocaInst* var = dyn_cast<AllocaInst>(in)) {
+      unsigned idx = live.varIndex.size();
+      live.varIndex.insert({var, idx});
+    }
+  }
+  unsigned nwords = (live.varIndex.size() + WORD_BITS - 1) / WORD_BITS;
+  live.nwords = nwords;
+
   BlockSetTy changed;
-  
+
   // add basic blocks with return statement
   for(Function::iterator bi = f->begin(), be = f->end(); bi != be; ++bi) {
     BasicBlock *bb = &*bi;
-    
+
     // note: ignoring "error blocks" (unreachable terminators)
     if (ReturnInst::classof(bb->getTerminator())) {
-      VarMapTy usedAfter = VarMapTy(nvars, false);
-      VarMapTy killedAfter = VarMapTy(nvars, true);
-      blockStates.insert({bb, BlockStateTy(usedAfter, killedAfter)});
+      live.blockOffsets.insert({bb, live.blockBits.size()});
+      live.blockBits.resize(live.blockBits.size() + nwords, 0); // used after
+      live.blockBits.resize(live.blockBits.size() + nwords, ~(uint64_t) 0); // killed after
       changed.insert(bb);
     }
   }
-  
+
   // find variables possibly used/killed after each block
+  std::vector<uint64_t> used(nwords);
+  std::vector<uint64_t> killed(nwords);
   while(!changed.empty()) {
     BlockSetTy::iterator bi = changed.begin();
     BasicBlock* bb = *bi;
     changed.erase(bi);
-    
-    auto bsearch = blockStates.find(bb);
-    myassert(bsearch != blockStates.end());
-    BlockStateTy& s = bsearch->second;
-    
-    VarMapTy used = s.usedAfter; // copy
-    VarMapTy killed = s.killedAfter; // copy
-    
+
+    auto bsearch = live.blockOffsets.find(bb);
+    myassert(bsearch != live.blockOffsets.end());
+    unsigned offset = bsearch->second;
+
+    std::copy(live.blockBits.begin() + offset, live.blockBits.begin() + offset + nwords, used.begin());
+    std::copy(live.blockBits.begin() + offset + nwords, live.blockBits.begin() + offset + 2 * nwords, killed.begin());
+
     // compute variables live at block start
     for(BasicBlock::reverse_iterator ii = bb->rbegin(), ie = bb->rend();  ii != ie; ++ii) {
       Instruction *in = &*ii;
-      applyInstruction(in, used, killed, varIndex);     
+      live.applyInstruction(in, used.data(), killed.data());
     }
-    
+
     // merge into block predecessors
     for(pred_iterator pi = pred_begin(bb), pe = pred_end(bb); pi != pe; ++pi) {
       BasicBlock* pb = *pi;
 
-      auto bsearch = blockStates.find(pb);
-      if (bsearch == blockStates.end()) {
-        blockStates.insert({pb, BlockStateTy(used, killed)});
+      auto psearch = live.blockOffsets.find(pb);
+      if (psearch == live.blockOffsets.end()) {
+        live.blockOffsets.insert({pb, live.blockBits.size()});
+        live.blockBits.insert(live.blockBits.end(), used.begin(), used.end());
+        live.blockBits.insert(live.blockBits.end(), killed.begin(), killed.end());
         changed.insert(pb);
       } else {
-        BlockStateTy& ps = bsearch->second;
-        VarMapTy& prevUsed = ps.usedAfter;
-        VarMapTy& prevKilled = ps.killedAfter;
-        
-        for(unsigned vi = 0; vi < nvars; vi++) {
-          bool change = false;
-          if (used[vi] && !prevUsed[vi]) { // union of used variables
-            prevUsed[vi] = true;
-            change = true;
-          }
-          if (killed[vi] && !prevKilled[vi]) { // union of killed variables
-            prevKilled[vi] = true;
+        uint64_t* prevUsed = &live.blockBits[psearch->second];
+        uint64_t* prevKilled = prevUsed + nwords;
+
+        bool change = false;
+        for(unsigned w = 0; w < nwords; w++) { // union of used and of killed variables
+          uint64_t newUsed = prevUsed[w] | used[w];
+          uint64_t newKilled = prevKilled[w] | killed[w];
+          if (newUsed != prevUsed[w] || newKilled != prevKilled[w]) {
+            prevUsed[w] = newUsed;
+            prevKilled[w] = newKilled;
             change = true;
-          }          
-          if (change) {
-            changed.insert(pb);
           }
         }
+        if (change) {
+          changed.insert(pb);
+        }
       }
     }
   }
-  
-  // convert results, and compute for each instruction
-  LiveVarsTy live;
-  
-  for(BlockStatesTy::iterator si = blockStates.begin(), se = blockStates.end(); si != se; ++si) {
-    BasicBlock* bb = si->first;
-    BlockStateTy& s = si->second;
-    VarMapTy used = s.usedAfter;
-    VarMapTy killed = s.killedAfter;
-    
-    for(BasicBlock::reverse_iterator ii = bb->rbegin(), ie = bb->rend();  ii != ie; ++ii) {
+
+  // record variable accesses of blocks from which a return is reachable
+  for(Function::iterator bi = f->begin(), be = f->end(); bi != be; ++bi) {
+    BasicBlock *bb = &*bi;
+
+    if (live.blockOffsets.find(bb) == live.blockOffsets.end()) {
+      continue;
+    }
+    for(BasicBlock::iterator ii = bb->begin(), ie = bb->end(); ii != ie; ++ii) {
       Instruction *in = &*ii;
-      
-      // record used vars for instruction
-      //   (result liveness info is relevant "after this instruction executes")
-      
-      VarsLiveness vars;
-      for(unsigned vi = 0; vi < nvars; vi++) {
-        if (used[vi]) {
-          vars.possiblyUsed.insert(varIndex.at(vi));
+
+      if (StoreInst* si = dyn_cast<StoreInst>(in)) {
+        if (AllocaInst* var = dyn_cast<AllocaInst>(si->getPointerOperand())) {
+          live.accesses.push_back({live.varIndex.at(var), false});
         }
-        if (killed[vi]) {
-          vars.possiblyKilled.insert(varIndex.at(vi));
+      }
+      if (LoadInst* li = dyn_cast<LoadInst>(in)) {
+        if (AllocaInst* var = dyn_cast<AllocaInst>(li->getPointerOperand())) {
+          live.accesses.push_back({live.varIndex.at(var), true});
         }
       }
-      live.insert({in, vars});
-      
-      applyInstruction(in, used, killed, varIndex);
+      // liveness info is relevant "after this instruction executes"
+      live.nextAccess.insert({in, live.accesses.size()});
     }
+    live.accesses.push_back({VarAccessTy::END_OF_BLOCK, false});
   }
   return live;
 }
+
+const VarsLiveness* LiveVarsTy::find(Instruction *in) {
+
+  auto asearch = nextAccess.find(in);
+  if (asearch == nextAccess.end()) {
+    return NULL;
+  }
+  auto bsearch = blockOffsets.find(in->getParent());
+  myassert(bsearch != blockOffsets.end());
+
+  result.live = this;
+  result.accesses = accesses.data() + asearch->second;
+  result.possiblyUsedAtEnd = blockBits.data() + bsearch->second;
+  result.possiblyKilledAtEnd = result.possiblyUsedAtEnd + nwords;
+  return &result;
+}
@@ -3,32 +3,85 @@
 
 #include "common.h"
 
+#include <cstdint>
 #include <unordered_map>
+#include <vector>
 
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Function.h>
 
 using namespace llvm;
 
+class LiveVarsTy;
+
+// a load or store of a variable in a block
+//   the accesses of a block are kept in order, followed by an end marker
+
+struct VarAccessTy {
+  unsigned var; // index of the variable, or END_OF_BLOCK
+  bool load;
+
+  static const unsigned END_OF_BLOCK = ~0U;
+};
+
+// which variables are live after an instruction executes
+//   only valid until the next query to LiveVarsTy
+//
+//   a variable is live as given by its first access after the instruction in
+//   the block, or if there is none, as at the end of the block
+
 struct VarsLiveness {
-  VarsSetTy possiblyUsed; // the variable is read on some path
-  VarsSetTy possiblyKilled; // the variable is overwritten and not read before that, or it is ignored, on some path
-  
-  bool isPossiblyUsed(AllocaInst* var) {
-    return possiblyUsed.find(var) != possiblyUsed.end();
-  }
-  
-  bool isPossiblyKilled(AllocaInst* var) {
-    return possiblyKilled.find(var) != possiblyKilled.end();
-  }
-  
-  bool isDefinitelyUsed(AllocaInst* var) { // we are certain the variable is used (loaded)
+  const LiveVarsTy* live;
+  const VarAccessTy* accesses; // accesses after the instruction
+  const uint64_t* possiblyUsedAtEnd; // the variable is read on some path
+  const uint64_t* possiblyKilledAtEnd; // the variable is overwritten and not read before that, or it is ignored, on some path
+
+  bool isPossiblyUsed(AllocaInst* var) const;
+  bool isPossiblyKilled(AllocaInst* var) const;
+
+  bool isDefinitelyUsed(AllocaInst* var) const { // we are certain the variable is used (loaded)
     return !isPossiblyKilled(var);
   }
 };
 
-// which variables are live after the given instruction executes
-typedef std::unordered_map<Instruction*, VarsLiveness> LiveVarsTy;
+// liveness of the local variables of a function
+//
+//   the variables possibly used and possibly killed after each basic block
+//   are kept as bit vectors; for each instruction, only the position of the
+//   next variable access in its block is kept, so a query does not need to
+//   compute anything for the other instructions of the block
+
+class LiveVarsTy {
+
+  typedef uint64_t WordTy;
+  typedef std::vector<WordTy> BitsTy;
+
+  std::unordered_map<AllocaInst*, unsigned> varIndex;
+  unsigned nwords;
+
+  std::unordered_map<BasicBlock*, unsigned> blockOffsets; // into blockBits
+  BitsTy blockBits; // for each block, used after and killed after
+
+  std::vector<VarAccessTy> accesses; // for each block
+  std::unordered_map<Instruction*, unsigned> nextAccess; // into accesses, for each instruction
+  VarsLiveness result;
+
+  friend struct VarsLiveness;
+  friend LiveVarsTy findLiveVariables(Function *f);
+
+  int indexOf(AllocaInst* var) const {
+    auto vsearch = varIndex.find(var);
+    return (vsearch == varIndex.end()) ? -1 : (int) vsearch->second;
+  }
+  void applyInstruction(Instruction *in, WordTy* used, WordTy* killed) const;
+
+  public:
+    LiveVarsTy(): varIndex(), nwords(0), blockOffsets(), blockBits(), accesses(), nextAccess(), result() {};
+
+    // NULL for instructions from which no return is reachable (e.g. in error blocks)
+    const VarsLiveness* find(Instruction *in);
+};
+
 LiveVarsTy findLiveVariables(Function *f);
 
 #endif
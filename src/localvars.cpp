@@ -0,0 +1,86 @@
+
+#include "localvars.h"
+
+#include "balance.h"
+#include "freshvars.h"
+#include "guards.h"
+#include "vectors.h"
+
+#include <unordered_set>
+
+#include <llvm/IR/InstIterator.h>
+
+using namespace llvm;
+
+FunctionVarsTy::FunctionVarsTy(Function *f, const GlobalsTy* g): numbers(), allocas(), kinds(), checkingKinds(), intGuardIndexes(), sexpGuardIndexes(),
+  reported(), intGuards(), sexpGuards() {
+
+  std::unordered_set<AllocaInst*> vectorOnlyVars;
+
+  for(inst_iterator ii = inst_begin(*f), ie = inst_end(*f); ii != ie; ++ii) {
+    Instruction *in = &*ii;
+    if (AllocaInst *var = dyn_cast<AllocaInst>(in)) {
+      numbers.insert({var, allocas.size()}); // in the order of the function, so that the index is deterministic
+      allocas.push_back(var);
+      continue;
+    }
+    AllocaInst *vvar;
+    if (isVectorOnlyVarOperation(in, vvar)) {
+      vectorOnlyVars.insert(vvar);
+    }
+  }
+
+  unsigned n = allocas.size();
+  kinds.assign(n, 0);
+  intGuardIndexes.assign(n, NOT_A_GUARD);
+  sexpGuardIndexes.assign(n, NOT_A_GUARD);
+  reported.assign(n, false);
+
+  for(unsigned num = 0; num < n; num++) {
+    AllocaInst *var = allocas[num];
+
+    if (isIntGuardVariable(var)) {
+      kinds[num] |= VK_INT_GUARD;
+      intGuardIndexes[num] = intGuards.size();
+      intGuards.push_back(var);
+    }
+    if (g && isSEXPGuardVariable(var, g)) {
+      kinds[num] |= VK_SEXP_GUARD;
+    }
+    if ((kinds[num] & VK_SEXP_GUARD) || vectorOnlyVars.find(var) != vectorOnlyVars.end()) {
+      sexpGuardIndexes[num] = sexpGuards.size();
+      sexpGuards.push_back(var);
+    }
+  }
+}
+
+void FunctionVarsTy::classifyForChecking(const GlobalsTy* g) {
+
+  if (!checkingKinds.empty() || allocas.empty()) {
+    return;
+  }
+  std::vector<unsigned> ckinds(allocas.size(), 0);
+  for(unsigned num = 0; num < allocas.size(); num++) {
+    AllocaInst *var = allocas[num];
+
+    if (g && g->unprotectFunction && isProtectionCounterVariable(var, g->unprotectFunction)) {
+      ckinds[num] |= VK_PROTECTION_COUNTER;
+    }
+    if (g && g->ppStackTopVariable && isProtectionStackTopSaveVariable(var, g->ppStackTopVariable)) {
+      ckinds[num] |= VK_STACK_TOP_SAVE;
+    }
+    if (isSEXP(var) && isVarCheckedFresh(var)) {
+      ckinds[num] |= VK_CHECKED_FRESH;
+    }
+  }
+  checkingKinds.swap(ckinds);
+}
+
+bool FunctionVarsTy::markReported(AllocaInst* var) {
+  unsigned num = number(var);
+  if (num == NOT_A_VAR || reported[num]) {
+    return false;
+  }
+  reported[num] = true;
+  return true;
+}
@@ -0,0 +1,95 @@
+#ifndef RCHK_LOCALVARS_H
+#define RCHK_LOCALVARS_H
+
+#include "common.h"
+
+#include <unordered_map>
+#include <vector>
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+
+using namespace llvm;
+
+// kinds of local variables (allocas), a variable may be of multiple kinds
+
+const unsigned VK_INT_GUARD = 1;
+const unsigned VK_SEXP_GUARD = 2;
+const unsigned VK_PROTECTION_COUNTER = 4;
+const unsigned VK_STACK_TOP_SAVE = 8;
+const unsigned VK_CHECKED_FRESH = 16; // SEXP variable that can be tracked by the fresh variables checker
+
+const unsigned VK_GUARD_KINDS = VK_INT_GUARD | VK_SEXP_GUARD;
+
+const unsigned NOT_A_GUARD = (unsigned) -1;
+
+// local variables of a function, classified once per function and kept with
+// the module analyses (getFunctionVars)
+//
+//   each variable (alloca) has a dense number, in the order of the function;
+//   the kinds and guard indexes are kept in vectors indexed by that number
+//
+//   the integer and SEXP guards have each a dense index, which is fixed for
+//   the function, so that packed guard states have always the same size;
+//   the SEXP guard index also covers variables used in vector-only
+//   operations, which get a guard state even when not guards
+//
+//   the guard kinds are always classified, the kinds only used when checking
+//   the function (protection counter, stack top save, checked fresh) only
+//   after classifyForChecking
+
+class FunctionVarsTy {
+
+  std::unordered_map<AllocaInst*, unsigned, VarBoolCacheTy_hash> numbers;
+  std::vector<AllocaInst*> allocas; // by number
+  std::vector<unsigned> kinds; // by number, guard kinds
+  std::vector<unsigned> checkingKinds; // by number, other kinds, empty until classifyForChecking
+  std::vector<unsigned> intGuardIndexes; // by number, NOT_A_GUARD for other variables
+  std::vector<unsigned> sexpGuardIndexes; // by number, NOT_A_GUARD for other variables
+  std::vector<bool> reported; // by number, see markReported
+  std::vector<AllocaInst*> intGuards;
+  std::vector<AllocaInst*> sexpGuards;
+
+  public:
+    static const unsigned NOT_A_VAR = (unsigned) -1;
+
+    FunctionVarsTy(Function *f, const GlobalsTy* g);
+
+    // classifies the kinds only used when checking the function, only once
+    void classifyForChecking(const GlobalsTy* g);
+
+    unsigned number(AllocaInst* var) const { // or NOT_A_VAR
+      auto nsearch = numbers.find(var);
+      return (nsearch == numbers.end()) ? NOT_A_VAR : nsearch->second;
+    }
+    unsigned nVars() const { return allocas.size(); }
+    AllocaInst* var(unsigned num) const { return allocas[num]; }
+
+    bool is(unsigned num, unsigned kind) const { // checking kinds only after classifyForChecking
+      return (kind & VK_GUARD_KINDS) ? (kinds[num] & kind) : (checkingKinds[num] & kind);
+    }
+    bool is(AllocaInst* var, unsigned kind) const {
+      unsigned num = number(var);
+      return num != NOT_A_VAR && is(num, kind);
+    }
+    unsigned intGuardIndex(AllocaInst* var) const {
+      unsigned num = number(var);
+      return (num == NOT_A_VAR) ? NOT_A_GUARD : intGuardIndexes[num];
+    }
+    unsigned sexpGuardIndex(AllocaInst* var) const {
+      unsigned num = number(var);
+      return (num == NOT_A_VAR) ? NOT_A_GUARD : sexpGuardIndexes[num];
+    }
+
+    unsigned nIntGuards() const { return intGuards.size(); }
+    unsigned nSEXPGuards() const { return sexpGuards.size(); }
+    AllocaInst* intGuard(unsigned idx) const { return intGuards[idx]; }
+    AllocaInst* sexpGuard(unsigned idx) const { return sexpGuards[idx]; }
+
+    // returns true the first time it is called for a variable, so that
+    //   a message about a variable can be reported only once; only to be
+    //   called by the (single) thread checking the function
+    bool markReported(AllocaInst* var);
+};
+
+#endif
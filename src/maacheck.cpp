@@ -26,57 +26,20 @@
 #include <llvm/Support/raw_ostream.h>
 
 #include "allocators.h"
+#include "analyses.h"
 #include "cgclosure.h"
+#include "tools.h"
 
 using namespace llvm;
 
-enum ArgExpKind {
-  AK_NOALLOC = 0,  // no allocation
-  AK_ALLOCATING,   // allocation, but not returning a fresh object
-  AK_FRESH         // allocation and possibly returning a fresh object
-};
-
-ArgExpKind classifyArgumentExpression(Value *arg, FunctionsInfoMapTy& functionsMap, unsigned gcFunctionIndex, FunctionsSetTy& possibleAllocators) {
-
-  if (!CallInst::classof(arg)) {
-    // argument does not come (immediatelly) from a call
-    return AK_NOALLOC;
-  }
-
-  CallInst *cinst = cast<CallInst>(arg);
-  Function *fun = cinst->getCalledFunction();
-  if (!fun) {
-    return AK_NOALLOC;
-  }
-
-  if (!isAllocatingFunction(fun, functionsMap, gcFunctionIndex)) {
-    // argument does not come from a call to an allocating function
-    return AK_NOALLOC;
-  }
-
-  if (possibleAllocators.find(fun) != possibleAllocators.end()) {
-    // the argument allocates and returns a fresh object
-    return AK_FRESH;
-  }
-  return AK_ALLOCATING;
-}
-
-
-int main(int argc, char* argv[])
-{
-  LLVMContext context;
-  FunctionsOrderedSetTy functionsOfInterestSet;
-  FunctionsVectorTy functionsOfInterestVector;
-  
-  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);  
+static int runMaacheck(Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
   
-  FunctionsInfoMapTy functionsMap;
-  buildCGClosure(m, functionsMap, true /* ignore error paths */);
+  ModuleAnalysesTy *analyses = getModuleAnalyses(m);
+  FunctionsInfoMapTy& functionsMap = *analyses->getFunctionsInfo();
   
-  unsigned gcFunctionIndex = getGCFunctionIndex(functionsMap, m);
+  const FunctionsBitsTy& gcCallers = analyses->getGCCallers();
   
-  FunctionsSetTy possibleAllocators;
-  findPossibleAllocators(m, possibleAllocators); // FIXME: use context-sensitive (more precise) detection
+  FunctionsSetTy& possibleAllocators = *analyses->getPossibleAllocators(); // FIXME: use context-sensitive (more precise) detection
 
   for(FunctionsVectorTy::iterator FI = functionsOfInterestVector.begin(), FE = functionsOfInterestVector.end(); FI != FE; ++FI) {
 
@@ -110,13 +73,13 @@ int main(int argc, char* argv[])
           unsigned nvals = phi->getNumIncomingValues();
           k = AK_NOALLOC;
           for(unsigned i = 0; i < nvals; i++) {
-            ArgExpKind cur = classifyArgumentExpression(phi->getIncomingValue(i), functionsMap, gcFunctionIndex, possibleAllocators);
+            ArgExpKind cur = classifyArgumentExpression(phi->getIncomingValue(i), functionsMap, gcCallers, possibleAllocators);
             if (cur > k) {
               k = cur;
             }
           }
         } else {
-          k = classifyArgumentExpression(o, functionsMap, gcFunctionIndex, possibleAllocators);
+          k = classifyArgumentExpression(o, functionsMap, gcCallers, possibleAllocators);
         }
 
         if (k >= AK_ALLOCATING) nAllocatingArgs++;
@@ -130,5 +93,14 @@ int main(int argc, char* argv[])
     }
   }
 
-  delete m;
+  return 0;
+}
+
+const ToolTy maacheckTool = { "maacheck", NULL, runMaacheck };
+
+#ifndef RCHK_DRIVER
+int main(int argc, char* argv[])
+{
+  return runTool(argc, argv, maacheckTool);
 }
+#endif
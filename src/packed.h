@@ -0,0 +1,64 @@
+#ifndef RCHK_PACKED_H
+#define RCHK_PACKED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// a vector of small fields (e.g. states of guard variables) packed into
+// 64-bit words; field i holds the state of the variable with index i
+//
+//   fields not stored are zero (by convention the unknown state), so two
+//   vectors that differ only in trailing zero words are equal; a state packed
+//   before the variable index grew is equal to the same state packed after
+//
+//   comparison works on whole words, and unpacking can skip
+//   words with no known state
+
+template <unsigned FIELD_BITS> struct PackedFieldsTy {
+
+  typedef uint64_t WordTy;
+  typedef std::vector<WordTy> WordsTy;
+
+  static const unsigned WORD_BITS = 64;
+  static const unsigned FIELDS_PER_WORD = WORD_BITS / FIELD_BITS;
+  static const WordTy FIELD_MASK = (((WordTy) 1) << FIELD_BITS) - 1;
+
+  static_assert(WORD_BITS % FIELD_BITS == 0, "fields must not span words");
+
+  WordsTy words;
+
+  PackedFieldsTy(unsigned nfields) : words((nfields + FIELDS_PER_WORD - 1) / FIELDS_PER_WORD, 0) {};
+
+  unsigned size() const { return words.size() * FIELDS_PER_WORD; } // number of fields, including the padding
+
+  unsigned get(unsigned idx) const {
+    unsigned w = idx / FIELDS_PER_WORD;
+    if (w >= words.size()) {
+      return 0;
+    }
+    return (words[w] >> ((idx % FIELDS_PER_WORD) * FIELD_BITS)) & FIELD_MASK;
+  }
+
+  void set(unsigned idx, unsigned value) { // the field must be zero
+    words[idx / FIELDS_PER_WORD] |= ((WordTy) value & FIELD_MASK) << ((idx % FIELDS_PER_WORD) * FIELD_BITS);
+  }
+
+  bool operator==(const PackedFieldsTy& other) const {
+    const WordsTy& shorter = (words.size() <= other.words.size()) ? words : other.words;
+    const WordsTy& longer = (words.size() <= other.words.size()) ? other.words : words;
+    size_t n = shorter.size();
+    WordTy diff = 0;
+    for(size_t i = 0; i < n; i++) { // no early exit, so that it can be vectorized
+      diff |= shorter[i] ^ longer[i];
+    }
+    for(size_t i = n, e = longer.size(); i < e; i++) {
+      diff |= longer[i];
+    }
+    return diff == 0;
+  }
+
+  size_t bytes() const { return words.capacity() * sizeof(WordTy); }
+};
+
+#endif
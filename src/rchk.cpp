@@ -0,0 +1,127 @@
+/*
+  Runs several of the checking tools in one process, on one parsed and
+  linked module, so that they share the module analyses (error functions,
+  allocators, callgraph).  The output of each tool goes to a separate file,
+  named as the checked file with the extension replaced by the tool name
+  (e.g. pkg.so.bcheck for pkg.so.bc), in the format of the tool.
+
+  rchk [--tools TOOL,TOOL,...] [options] base_file.bc [module_file.bc]
+
+  The options are those of parseArgsReadIR (including --batch) and of the
+  selected tools.  By default, the tools are bcheck, maacheck and fficheck.
+  Messages of the driver itself (e.g. about linking) go to the standard
+  error, in batch mode to the file with extension "rchk".
+*/
+
+#include "common.h"
+#include "analyses.h"
+#include "tools.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <llvm/Support/raw_ostream.h>
+
+using namespace llvm;
+
+static const ToolTy* const allTools[] = {
+  &alloccheckTool, &bcheckTool, &cgcheckTool, &csfpcheckTool, &errcheckTool, &fficheckTool,
+  &glcheckTool, &maacheckTool, &sfpcheckTool, &symcheckTool, &ueacheckTool, &veccheckTool
+};
+
+static const ToolTy* findTool(const std::string& name) {
+
+  for(const ToolTy* tool : allTools) {
+    if (name == tool->name) {
+      return tool;
+    }
+  }
+  return NULL;
+}
+
+// runs the tool with the standard output and error redirected to its output file
+
+static int runToolToFile(const ToolTy& tool, Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector,
+  LLVMContext& context, const std::string& outFname) {
+
+  outs().flush();
+  errs().flush();
+  int fd = open(outFname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    errs() << "ERROR: Cannot write output file " << outFname << "\n";
+    return 1;
+  }
+  int savedOut = dup(STDOUT_FILENO);
+  int savedErr = dup(STDERR_FILENO);
+  dup2(fd, STDOUT_FILENO);
+  dup2(fd, STDERR_FILENO);
+  close(fd);
+
+  int res = tool.run(m, functionsOfInterestSet, functionsOfInterestVector, context);
+
+  outs().flush();
+  errs().flush();
+  dup2(savedOut, STDOUT_FILENO);
+  dup2(savedErr, STDERR_FILENO);
+  close(savedOut);
+  close(savedErr);
+  return res;
+}
+
+int main(int argc, char* argv[])
+{
+  std::string toolsArg = "bcheck,maacheck,fficheck";
+  extractOption(argc, argv, "--tools", toolsArg);
+
+  std::vector<const ToolTy*> tools;
+  std::istringstream names(toolsArg);
+  std::string name;
+  while(std::getline(names, name, ',')) {
+    if (name.empty()) {
+      continue;
+    }
+    const ToolTy* tool = findTool(name);
+    if (!tool) {
+      errs() << "ERROR: Unknown tool " << name << ", the tools are:";
+      for(const ToolTy* t : allTools) {
+        errs() << " " << t->name;
+      }
+      errs() << "\n";
+      exit(1);
+    }
+    if (std::find(tools.begin(), tools.end(), tool) != tools.end()) {
+      continue;
+    }
+    tools.push_back(tool);
+    if (tool->parseOptions) {
+      tool->parseOptions(argc, argv);
+    }
+  }
+
+  LLVMContext context;
+  FunctionsOrderedSetTy functionsOfInterestSet;
+  FunctionsVectorTy functionsOfInterestVector;
+
+  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);
+
+  int res = 0;
+  for(std::vector<const ToolTy*>::iterator ti = tools.begin(), te = tools.end(); ti != te; ++ti) {
+    const ToolTy* tool = *ti;
+    std::string outFname = getToolOutputFname(tool->name);
+
+    if (runToolToFile(*tool, m, functionsOfInterestSet, functionsOfInterestVector, context, outFname)) {
+      errs() << "ERROR: Tool " << tool->name << " failed, see " << outFname << "\n";
+      res = 1;
+    }
+  }
+
+  forgetModuleAnalyses(m);
+  delete m;
+  return res;
+}
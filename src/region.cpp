@@ -0,0 +1,68 @@
+
+#include "region.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <llvm/Support/raw_ostream.h>
+
+using namespace llvm;
+
+thread_local StateRegion* StateRegion::current = NULL;
+
+void* StateRegion::allocateSlow(size_t bytes) {
+
+  if (bytes > CHUNK_SIZE / 4) {
+    char *block = static_cast<char*>(malloc(bytes));
+    if (!block) {
+      errs() << "ERROR: out of memory when allocating checking states\n";
+      exit(1);
+    }
+    largeBlocks.push_back(block);
+    return block;
+  }
+
+  if (top != NULL) {
+    currentChunk++;
+  }
+  if (currentChunk == chunks.size()) {
+    char *chunk = static_cast<char*>(malloc(CHUNK_SIZE));
+    if (!chunk) {
+      errs() << "ERROR: out of memory when allocating checking states\n";
+      exit(1);
+    }
+    chunks.push_back(chunk);
+  }
+  top = chunks[currentChunk];
+  end = top + CHUNK_SIZE;
+
+  void *p = top;
+  top += bytes;
+  return p;
+}
+
+void StateRegion::reset() {
+
+  for(std::vector<char*>::iterator bi = largeBlocks.begin(), be = largeBlocks.end(); bi != be; ++bi) {
+    free(*bi);
+  }
+  largeBlocks.clear();
+  std::fill(freeLists.begin(), freeLists.end(), (void *) NULL);
+
+  currentChunk = 0;
+  if (chunks.empty()) {
+    top = NULL;
+    end = NULL;
+  } else {
+    top = chunks[0];
+    end = top + CHUNK_SIZE;
+  }
+  allocatedBytes = 0;
+}
+
+StateRegion::~StateRegion() {
+  reset();
+  for(std::vector<char*>::iterator ci = chunks.begin(), ce = chunks.end(); ci != ce; ++ci) {
+    free(*ci);
+  }
+}
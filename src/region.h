@@ -0,0 +1,121 @@
+#ifndef RCHK_REGION_H
+#define RCHK_REGION_H
+
+#include "common.h"
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// region (arena) for checking states
+//
+//   memory is taken from large chunks by bumping a pointer, freed blocks
+//   are kept in free lists by size and reused, and all memory of the region
+//   is released at once by reset() - the chunks are kept for reuse
+//
+//   the region does not run any destructors, so it can only be reset when
+//   no object allocated in it is still in use
+
+class StateRegion {
+
+  static const size_t GRANULE = sizeof(void*);
+  static const size_t CHUNK_SIZE = 1 << 20;
+  static const size_t MAX_FREE_LIST_SIZE = 512; // larger freed blocks are not reused until reset
+
+  std::vector<char*> chunks;
+  std::vector<char*> largeBlocks; // blocks too large to fit into a chunk
+  unsigned currentChunk;
+  char *top;
+  char *end;
+  std::vector<void*> freeLists; // index is size in granules
+  size_t allocatedBytes;
+
+  public:
+    StateRegion(): chunks(), largeBlocks(), currentChunk(0), top(NULL), end(NULL), freeLists(MAX_FREE_LIST_SIZE / GRANULE + 1, NULL), allocatedBytes(0) {};
+    ~StateRegion();
+
+    void* allocate(size_t size) {
+      size_t ngranules = size ? (size + GRANULE - 1) / GRANULE : 1;
+      if (ngranules < freeLists.size() && freeLists[ngranules]) {
+        void *p = freeLists[ngranules];
+        freeLists[ngranules] = *static_cast<void**>(p);
+        return p;
+      }
+      size_t bytes = ngranules * GRANULE;
+      allocatedBytes += bytes;
+      if (bytes > (size_t) (end - top)) {
+        return allocateSlow(bytes);
+      }
+      void *p = top;
+      top += bytes;
+      return p;
+    }
+
+    void deallocate(void *p, size_t size) {
+      size_t ngranules = size ? (size + GRANULE - 1) / GRANULE : 1;
+      if (ngranules < freeLists.size()) {
+        *static_cast<void**>(p) = freeLists[ngranules];
+        freeLists[ngranules] = p;
+      }
+    }
+
+    void reset();
+    size_t size() const { return allocatedBytes; } // bytes taken from chunks since last reset
+
+    static thread_local StateRegion* current; // region used by default-constructed allocators
+
+    // makes a region current for the lifetime of the scope
+    struct Scope {
+      StateRegion* const saved;
+      Scope(StateRegion* region): saved(current) { current = region; }
+      ~Scope() { current = saved; }
+    };
+
+  private:
+    void* allocateSlow(size_t bytes);
+};
+
+// allocator for containers in checking states
+//   allocates from the region current at the time the container was created,
+//   or from the heap when there was no current region
+
+template <class T>
+struct RegionAllocator {
+
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  StateRegion* region;
+
+  RegionAllocator(): region(StateRegion::current) {};
+  RegionAllocator(StateRegion* region): region(region) {};
+  template <class U> RegionAllocator(const RegionAllocator<U>& other): region(other.region) {};
+
+  T* allocate(size_t n) {
+    static_assert(alignof(T) <= sizeof(void*), "region allocator does not support over-aligned types");
+    if (region) {
+      return static_cast<T*>(region->allocate(n * sizeof(T)));
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t n) {
+    if (region) {
+      region->deallocate(p, n * sizeof(T));
+    } else {
+      ::operator delete(p);
+    }
+  }
+};
+
+template <class T, class U>
+bool operator==(const RegionAllocator<T>& lhs, const RegionAllocator<U>& rhs) { return lhs.region == rhs.region; }
+
+template <class T, class U>
+bool operator!=(const RegionAllocator<T>& lhs, const RegionAllocator<U>& rhs) { return lhs.region != rhs.region; }
+
+typedef std::basic_string<char, std::char_traits<char>, RegionAllocator<char>> RegionStringTy;
+
+#endif
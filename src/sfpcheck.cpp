@@ -18,24 +18,31 @@
 #include <llvm/Support/raw_ostream.h>
 
 #include "allocators.h"
+#include "analyses.h"
 #include "cgclosure.h"
 #include "exceptions.h"
 #include "lannotate.h"
+#include "tools.h"
 
 using namespace llvm;
 
-int main(int argc, char* argv[])
-{
-  LLVMContext context;
-  FunctionsOrderedSetTy functionsOfInterestSet;
-  FunctionsVectorTy functionsOfInterestVector;
+static int runSfpcheck(Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
   
-  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);
+  ModuleAnalysesTy *analyses = getModuleAnalyses(m);
+  FunctionsInfoMapTy& functionsMap = *analyses->getFunctionsInfo();
   
-  FunctionsInfoMapTy functionsMap;
-  buildCGClosure(m, functionsMap, true /* ignore error paths */);
+  // a call is a safepoint when the target may (transitively) call a function
+  // that calls into the GC and is not asserted non-allocating
   
-  unsigned gcFunctionIndex = getGCFunctionIndex(functionsMap, m);
+  const FunctionsBitsTy& gcCallers = analyses->getGCCallers();
+  std::vector<const FunctionInfo*> allocating;
+  for(FunctionsInfoMapTy::iterator fi = functionsMap.begin(), fe = functionsMap.end(); fi != fe; ++fi) {
+    const FunctionInfo& finfo = fi->second;
+    if (gcCallers[finfo.index] && !isAssertedNonAllocating(const_cast<Function*>(finfo.function))) {
+      allocating.push_back(&finfo);
+    }
+  }
+  FunctionsBitsTy safepoints = findCallersOf(functionsMap, allocating);
   
   errs() << "List of functions and callsites calling (recursively) into " << gcFunction << ":\n";
 
@@ -54,15 +61,20 @@ int main(int argc, char* argv[])
       const CallInfo& cinfo = *CI;
       const FunctionInfo *middleFinfo = cinfo.target;
         
-      for(std::vector<FunctionInfo*>::const_iterator TFI = middleFinfo->calledFunctionsList.begin(), TFE = middleFinfo->calledFunctionsList.end(); TFI != TFE; ++TFI) {
-        const FunctionInfo *targetFinfo = *TFI;
-          
-        if ((targetFinfo->callsFunctionMap)[gcFunctionIndex] && !isAssertedNonAllocating(const_cast<Function*>(targetFinfo->function))) {
-          annotateLine(sfpLines, cinfo.instruction);        
-        }
+      if (safepoints[middleFinfo->index]) {
+        annotateLine(sfpLines, cinfo.instruction);        
       }
     }
   }
   printLineAnnotations(sfpLines);
-  delete m;
+  return 0;
+}
+
+const ToolTy sfpcheckTool = { "sfpcheck", NULL, runSfpcheck };
+
+#ifndef RCHK_DRIVER
+int main(int argc, char* argv[])
+{
+  return runTool(argc, argv, sfpcheckTool);
 }
+#endif
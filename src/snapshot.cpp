@@ -0,0 +1,246 @@
+
+#include "snapshot.h"
+#include "callocators.h"
+
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <unistd.h>
+
+#include <llvm/Support/raw_ostream.h>
+
+using namespace llvm;
+
+const std::string SNAPSHOT_VERSION = "rchk-snapshot 2";
+
+static std::string snapshotFname;
+static BaseSnapshotTy* snapshot = NULL; // in use
+static BaseSnapshotTy* prepared = NULL; // loaded or computed, not yet in use
+static FunctionNamesSetTy baseDeclarations; // declared but not defined in the base
+
+bool parseSnapshotOptions(int& argc, char* argv[]) {
+  return extractOption(argc, argv, "--snapshot", snapshotFname);
+}
+
+const BaseSnapshotTy* getBaseSnapshot() {
+  return snapshot;
+}
+
+void addFunctionsByName(Module *m, const FunctionNamesSetTy& names, FunctionsSetTy& set) {
+  for(FunctionNamesSetTy::const_iterator ni = names.begin(), ne = names.end(); ni != ne; ++ni) {
+    Function *f = m->getFunction(*ni);
+    if (f) {
+      set.insert(f);
+    }
+  }
+}
+
+// FNV-1a hash of the file contents
+static bool hashFile(const std::string& fname, std::string& hash) {
+
+  std::ifstream in(fname, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  uint64_t h = 14695981039346656037ULL;
+  char buf[65536];
+  while(in) {
+    in.read(buf, sizeof(buf));
+    std::streamsize n = in.gcount();
+    for(std::streamsize i = 0; i < n; i++) {
+      h ^= (unsigned char) buf[i];
+      h *= 1099511628211ULL;
+    }
+  }
+  char str[17];
+  snprintf(str, sizeof(str), "%016llx", (unsigned long long) h);
+  hash = str;
+  return true;
+}
+
+// the snapshot is a text file with one tab-separated record per line
+
+static void splitLine(const std::string& line, std::vector<std::string>& fields) {
+  fields.clear();
+  size_t start = 0;
+  for(;;) {
+    size_t pos = line.find('\t', start);
+    if (pos == std::string::npos) {
+      fields.push_back(line.substr(start));
+      return;
+    }
+    fields.push_back(line.substr(start, pos - start));
+    start = pos + 1;
+  }
+}
+
+static void writeNames(std::ostream& out, const std::string& kind, const FunctionNamesSetTy& names) {
+  std::set<std::string> sorted(names.begin(), names.end()); // deterministic output
+  for(std::set<std::string>::iterator ni = sorted.begin(), ne = sorted.end(); ni != ne; ++ni) {
+    out << kind << "\t" << *ni << "\n";
+  }
+}
+
+static void writeKey(std::ostream& out, const std::string& kind, const CalledFunctionKeyTy& key) {
+  out << kind;
+  for(CalledFunctionKeyTy::const_iterator ki = key.begin(), ke = key.end(); ki != ke; ++ki) {
+    out << "\t" << *ki;
+  }
+  out << "\n";
+}
+
+static bool saveSnapshot(const BaseSnapshotTy& s, const std::string& hash) {
+
+  // write to a temporary file and rename, so that concurrent runs do not
+  // see a partially written snapshot
+  std::string tmpFname = snapshotFname + ".tmp" + std::to_string(getpid());
+  {
+    std::ofstream out(tmpFname);
+    if (!out) {
+      return false;
+    }
+    out << SNAPSHOT_VERSION << "\n";
+    out << "hash\t" << hash << "\n";
+    writeNames(out, "function", s.baseFunctions);
+    writeNames(out, "error", s.errorFunctions);
+    writeNames(out, "allocator", s.possibleAllocators);
+    writeNames(out, "allocating", s.allocatingFunctions);
+    for(SnapshotCalledFunctionsTy::const_iterator ci = s.calledFunctions.begin(), ce = s.calledFunctions.end(); ci != ce; ++ci) {
+      writeKey(out, "analyzed", ci->first);
+      const SnapshotCalledFunctionTy& r = ci->second;
+      for(CalledFunctionKeysTy::const_iterator ki = r.called.begin(), ke = r.called.end(); ki != ke; ++ki) {
+        writeKey(out, "calls", *ki);
+      }
+      for(CalledFunctionKeysTy::const_iterator ki = r.wrapped.begin(), ke = r.wrapped.end(); ki != ke; ++ki) {
+        writeKey(out, "wraps", *ki);
+      }
+    }
+    if (!out) {
+      return false;
+    }
+  }
+  return rename(tmpFname.c_str(), snapshotFname.c_str()) == 0;
+}
+
+static bool loadSnapshot(BaseSnapshotTy& s, const std::string& hash) {
+
+  std::ifstream in(snapshotFname);
+  if (!in) {
+    return false;
+  }
+  std::string line;
+  if (!std::getline(in, line) || line != SNAPSHOT_VERSION) {
+    return false;
+  }
+  if (!std::getline(in, line) || line != "hash\t" + hash) {
+    return false;
+  }
+  std::vector<std::string> fields;
+  SnapshotCalledFunctionTy* current = NULL;
+  while(std::getline(in, line)) {
+    splitLine(line, fields);
+    const std::string& kind = fields[0];
+    if (fields.size() < 2) {
+      return false;
+    }
+    if (kind == "function") {
+      s.baseFunctions.insert(fields[1]);
+    } else if (kind == "error") {
+      s.errorFunctions.insert(fields[1]);
+    } else if (kind == "allocator") {
+      s.possibleAllocators.insert(fields[1]);
+    } else if (kind == "allocating") {
+      s.allocatingFunctions.insert(fields[1]);
+    } else if (kind == "analyzed") {
+      current = &s.calledFunctions[CalledFunctionKeyTy(fields.begin() + 1, fields.end())];
+    } else if (kind == "calls" && current) {
+      current->called.push_back(CalledFunctionKeyTy(fields.begin() + 1, fields.end()));
+    } else if (kind == "wraps" && current) {
+      current->wrapped.push_back(CalledFunctionKeyTy(fields.begin() + 1, fields.end()));
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void addNames(const FunctionsSetTy& set, FunctionNamesSetTy& names) {
+  for(FunctionsSetTy::const_iterator fi = set.begin(), fe = set.end(); fi != fe; ++fi) {
+    names.insert((*fi)->getName().str());
+  }
+}
+
+static void computeSnapshot(Module *m, BaseSnapshotTy& s) {
+
+  for(Module::iterator fi = m->begin(), fe = m->end(); fi != fe; ++fi) {
+    Function *f = &*fi;
+    if (!f->isDeclaration()) {
+      s.baseFunctions.insert(f->getName().str());
+    }
+  }
+
+  CalledModuleTy *cm = CalledModuleTy::create(m);
+  cm->recordSnapshot(&s);
+  cm->getAllocatingCFunctions(); // computes the context-sensitive allocators
+
+  addNames(*cm->getErrorFunctions(), s.errorFunctions);
+  addNames(*cm->getPossibleAllocators(), s.possibleAllocators);
+  addNames(*cm->getAllocatingFunctions(), s.allocatingFunctions);
+  CalledModuleTy::release(cm);
+}
+
+void prepareBaseSnapshot(Module *m, const std::string& baseFname) {
+
+  if (snapshotFname.empty()) {
+    return;
+  }
+
+  for(Module::iterator fi = m->begin(), fe = m->end(); fi != fe; ++fi) {
+    Function *f = &*fi;
+    if (f->isDeclaration()) {
+      baseDeclarations.insert(f->getName().str());
+    }
+  }
+
+  std::string hash;
+  if (!hashFile(baseFname, hash)) {
+    errs() << "WARNING: cannot read base file " << baseFname << ", not using snapshot\n";
+    return;
+  }
+
+  BaseSnapshotTy *s = new BaseSnapshotTy();
+  if (loadSnapshot(*s, hash)) {
+    prepared = s;
+    return;
+  }
+
+  *s = BaseSnapshotTy(); // partially loaded or outdated
+  errs() << "Computing base snapshot " << snapshotFname << " for " << baseFname << "...\n";
+  computeSnapshot(m, *s);
+  if (!saveSnapshot(*s, hash)) {
+    errs() << "WARNING: cannot write snapshot file " << snapshotFname << "\n";
+  }
+  prepared = s;
+}
+
+void useBaseSnapshot(Module *m, const std::vector<std::string>& packageFunctions) {
+
+  if (!prepared) {
+    return;
+  }
+
+  for(std::vector<std::string>::const_iterator ni = packageFunctions.begin(), ne = packageFunctions.end(); ni != ne; ++ni) {
+    const std::string& name = *ni;
+    if (baseDeclarations.find(name) != baseDeclarations.end()) {
+      // a base function may call the package function, so base results may
+      // not be valid
+      errs() << "WARNING: package defines function " << name << " declared in base, not using snapshot\n";
+      delete prepared;
+      prepared = NULL;
+      return;
+    }
+    prepared->baseFunctions.erase(name);
+  }
+  snapshot = prepared;
+  prepared = NULL;
+}
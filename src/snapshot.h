@@ -0,0 +1,69 @@
+#ifndef RCHK_SNAPSHOT_H
+#define RCHK_SNAPSHOT_H
+
+#include "common.h"
+
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+
+// a snapshot of results of the whole-program analyses for the R base alone
+//
+// when checking a package, the base is linked with the package, but most of
+// the analysis work concerns the base, which does not change between
+// packages; the snapshot is computed once, saved to a file keyed by a hash
+// of the base bitcode file, and then (when the hash matches) loaded instead
+//
+// a base function is one defined in the base and not defined by the package;
+// its results are taken from the snapshot, only the package part is analyzed
+
+using namespace llvm;
+
+typedef std::unordered_set<std::string> FunctionNamesSetTy;
+
+// identifies a called function (with context) by names: function name,
+//   then one element per argument, "?" (unknown), "V" (vector) or "S" followed
+//   by the symbol name
+typedef std::vector<std::string> CalledFunctionKeyTy;
+typedef std::vector<CalledFunctionKeyTy> CalledFunctionKeysTy;
+
+struct SnapshotCalledFunctionTy {
+  CalledFunctionKeysTy called;
+  CalledFunctionKeysTy wrapped;
+};
+
+typedef std::map<CalledFunctionKeyTy, SnapshotCalledFunctionTy> SnapshotCalledFunctionsTy;
+
+struct BaseSnapshotTy {
+  FunctionNamesSetTy baseFunctions; // defined in the base and not by the package
+  FunctionNamesSetTy errorFunctions;
+  FunctionNamesSetTy possibleAllocators;
+  FunctionNamesSetTy allocatingFunctions;
+  SnapshotCalledFunctionsTy calledFunctions; // results of called function (context-sensitive) analysis
+
+  bool isBaseFunction(Function *f) const { return f && baseFunctions.find(f->getName().str()) != baseFunctions.end(); }
+};
+
+// removes option "--snapshot FILE" from the arguments, returns true if found
+bool parseSnapshotOptions(int& argc, char* argv[]);
+
+// loads the snapshot for base module m (read from baseFname), or computes and
+// saves it when the snapshot file is missing or was computed for a different base
+//   must be called before the package is linked into m
+void prepareBaseSnapshot(Module *m, const std::string& baseFname);
+
+// enables the snapshot for the linked module; packageFunctions are those
+// defined by the package
+void useBaseSnapshot(Module *m, const std::vector<std::string>& packageFunctions);
+
+// the snapshot in use, or NULL
+const BaseSnapshotTy* getBaseSnapshot();
+
+// adds the functions of m with given names to set
+void addFunctionsByName(Module *m, const FunctionNamesSetTy& names, FunctionsSetTy& set);
+
+#endif
@@ -7,13 +7,45 @@ using namespace llvm;
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/InstIterator.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 
 #include <llvm/Support/raw_ostream.h>
 
-bool isInstallConstantCall(Value *inst, std::string& symbolName) {
+#include <deque>
+
+static std::deque<std::string> symbolNames; // indexed by symbol id, references stay valid
+static std::unordered_map<std::string, SymbolIdTy> symbolIds;
+static std::unordered_map<const Value*, SymbolIdTy> installCalls; // install("X") calls with a constant name
+
+// only when loading the module
+static SymbolIdTy internSymbol(const std::string& symbolName) {
+  auto ssearch = symbolIds.find(symbolName);
+  if (ssearch != symbolIds.end()) {
+    return ssearch->second;
+  }
+  SymbolIdTy symbol = symbolNames.size();
+  symbolNames.push_back(symbolName);
+  symbolIds.insert({symbolName, symbol});
+  return symbol;
+}
+
+const std::string& getSymbolName(SymbolIdTy symbol) {
+  return symbolNames[symbol];
+}
+
+bool findSymbol(const std::string& symbolName, SymbolIdTy& symbol) {
+  auto ssearch = symbolIds.find(symbolName);
+  if (ssearch == symbolIds.end()) {
+    return false;
+  }
+  symbol = ssearch->second;
+  return true;
+}
+
+static bool parseInstallConstantCall(Value *inst, std::string& symbolName) {
   CallSite cs(inst);
   if (!cs) {
     return false;
@@ -48,10 +80,34 @@ bool isInstallConstantCall(Value *inst, std::string& symbolName) {
   if (!cda->isCString()) {
     return false;
   }
-  symbolName = cda->getAsCString();
+  symbolName = cda->getAsCString().str();
   return true;   
 }
 
+void findInstallCalls(Module *m) {
+
+  installCalls.clear(); // instructions may have been deleted when linking
+  for(Module::iterator fi = m->begin(), fe = m->end(); fi != fe; ++fi) {
+    Function *fun = &*fi;
+    for(inst_iterator ii = inst_begin(*fun), ie = inst_end(*fun); ii != ie; ++ii) {
+      Instruction *in = &*ii;
+      std::string symbolName;
+      if (parseInstallConstantCall(in, symbolName)) {
+        installCalls.insert({in, internSymbol(symbolName)});
+      }
+    }
+  }
+}
+
+bool isInstallConstantCall(Value *inst, SymbolIdTy& symbol) {
+  auto isearch = installCalls.find(inst);
+  if (isearch == installCalls.end()) {
+    return false;
+  }
+  symbol = isearch->second;
+  return true;
+}
+
 void findSymbols(Module *m, SymbolsMapTy* symbolsMap) {
 
   for(Module::global_iterator gi = m->global_begin(), ge = m->global_end(); gi != ge ; ++gi) {
@@ -60,7 +116,7 @@ void findSymbols(Module *m, SymbolsMapTy* symbolsMap) {
       continue;
     }
     bool foundInstall = false;
-    std::string symbolName;
+    SymbolIdTy symbol;
     
     for(Value::user_iterator ui = gv->user_begin(), ue = gv->user_end(); ui != ue; ++ui) {
       User *u = *ui;
@@ -68,14 +124,14 @@ void findSymbols(Module *m, SymbolsMapTy* symbolsMap) {
         continue;
       }
       Value *valueOp = cast<StoreInst>(u)->getValueOperand();
-      std::string name;
-      if (isInstallConstantCall(valueOp, name)) {
+      SymbolIdTy s;
+      if (isInstallConstantCall(valueOp, s)) {
         if (!foundInstall) {
-          symbolName = name;
+          symbol = s;
           foundInstall = true;
         } else {
-          if (symbolName != name) {
-            errs() << "ERROR: Multiple names for symbol " << gv->getName() << ": " << symbolName << " and " << name << "\n";
+          if (symbol != s) {
+            errs() << "ERROR: Multiple names for symbol " << gv->getName() << ": " << getSymbolName(symbol) << " and " << getSymbolName(s) << "\n";
             goto cannot_be_symbol;
           }
         }
@@ -91,7 +147,7 @@ void findSymbols(Module *m, SymbolsMapTy* symbolsMap) {
       }
     }
     if (foundInstall) {
-      symbolsMap->insert({gv, symbolName});
+      symbolsMap->insert({gv, symbol});
     }
     cannot_be_symbol:
       ;    
@@ -8,9 +8,25 @@
 
 using namespace llvm;
 
-typedef std::unordered_map<GlobalVariable*, std::string> SymbolsMapTy;
+// R symbol names are interned once, and then referred to by a small integer
+//   id, so that guard states and contexts are copied, compared and hashed
+//   without touching the strings
+//
+//   the names are interned when the module is loaded (findInstallCalls), before
+//   any checking threads start, so the lookups below need no locking
 
-bool isInstallConstantCall(Value *inst, std::string& symbolName);
+typedef unsigned SymbolIdTy;
+
+const std::string& getSymbolName(SymbolIdTy symbol);
+bool findSymbol(const std::string& symbolName, SymbolIdTy& symbol); // false if not interned
+
+typedef std::unordered_map<GlobalVariable*, SymbolIdTy> SymbolsMapTy;
+
+// interns the symbols of all calls install("X") with a constant name in the
+// module, to be called whenever functions are added to the module
+void findInstallCalls(Module *m);
+
+bool isInstallConstantCall(Value *inst, SymbolIdTy& symbol); // only after findInstallCalls
 void findSymbols(Module *m, SymbolsMapTy* symbolsMap = NULL);
 
 #endif
@@ -16,25 +16,20 @@
 
 #include <llvm/Support/raw_ostream.h>
 
+#include "analyses.h"
 #include "symbols.h"
+#include "tools.h"
 
 using namespace llvm;
 
-int main(int argc, char* argv[])
-{
-  LLVMContext context;
-  FunctionsOrderedSetTy functionsOfInterestSet;
-  FunctionsVectorTy functionsOfInterestVector;
-  
-  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);
+static int runSymcheck(Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
     // NOTE: functionsOfInterest ignored but (re-)analyzing the R core is necessary
   
-  SymbolsMapTy symbolsMap;
-  findSymbols(m, &symbolsMap);
+  SymbolsMapTy& symbolsMap = *getModuleAnalyses(m)->getSymbolsMap();
   
   for(SymbolsMapTy::iterator si = symbolsMap.begin(), se = symbolsMap.end(); si != se; ++si) {
     GlobalVariable *gv = si->first;
-    std::string& name = si->second;
+    const std::string& name = getSymbolName(si->second);
     
     errs() << "  " << gv->getName() << "  \"" << name << "\"    " << "\n";
   }
@@ -43,5 +38,14 @@ int main(int argc, char* argv[])
   // FIXME: the output could be sorted
   // FIXME: there could also be more detailed checks for ambiguous symbols (but I've not seen such in practice)
   
-  delete m;
+  return 0;
+}
+
+const ToolTy symcheckTool = { "symcheck", NULL, runSymcheck };
+
+#ifndef RCHK_DRIVER
+int main(int argc, char* argv[])
+{
+  return runTool(argc, argv, symcheckTool);
 }
+#endif
@@ -1,6 +1,8 @@
 #ifndef RCHK_TABLE_H
 #define RCHK_TABLE_H
 
+#include <algorithm>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -46,8 +48,12 @@ template <
 
   Table table;
   Index index;
+  bool deferring;
+  std::vector<Member*> deferred; // interned, but not yet indexed
   
   public:
+    IndexedInterningTable(): table(), index(), deferring(false), deferred() {};
+  
     const Member* intern(const Member& m) {
       auto msearch = table.find(m);
       if (msearch != table.end()) {
@@ -55,12 +61,33 @@ template <
       }
       
       Member n = m;
-      n.idx = index.size();
       const Member *intr = &*table.insert(n).first;
-      index.push_back(intr);
+      if (deferring) {
+        deferred.push_back(const_cast<Member*>(intr)); // idx is not part of the key
+      } else {
+        const_cast<Member*>(intr)->idx = index.size();
+        index.push_back(intr);
+      }
       return intr;
     }
     
+    // members interned from now on get their index only in indexDeferred,
+    // in the order given by less, so that the indexes do not depend on the
+    // order of interning (e.g. by concurrent threads)
+    void deferIndexing() {
+      deferring = true;
+    }
+    
+    template <class Less> void indexDeferred(Less less) {
+      std::sort(deferred.begin(), deferred.end(), [&less](const Member* a, const Member* b) { return less(*a, *b); });
+      for(typename std::vector<Member*>::iterator mi = deferred.begin(), me = deferred.end(); mi != me; ++mi) {
+        (*mi)->idx = index.size();
+        index.push_back(*mi);
+      }
+      deferred.clear();
+      deferring = false;
+    }
+    
     const Member* intern(const Member *m) {
       if (!m) {
         return NULL;
@@ -75,6 +102,8 @@ template <
     void clear() {
       table.clear();
       index.clear();
+      deferred.clear();
+      deferring = false;
     }
     
     const Index* getIndex() const {
@@ -0,0 +1,22 @@
+
+#include "tools.h"
+#include "analyses.h"
+
+using namespace llvm;
+
+int runTool(int argc, char* argv[], const ToolTy& tool) {
+
+  LLVMContext context;
+  FunctionsOrderedSetTy functionsOfInterestSet;
+  FunctionsVectorTy functionsOfInterestVector;
+
+  if (tool.parseOptions) {
+    tool.parseOptions(argc, argv);
+  }
+  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);
+  int res = tool.run(m, functionsOfInterestSet, functionsOfInterestVector, context);
+
+  forgetModuleAnalyses(m);
+  delete m;
+  return res;
+}
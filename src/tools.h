@@ -0,0 +1,44 @@
+#ifndef RCHK_TOOLS_H
+#define RCHK_TOOLS_H
+
+#include "common.h"
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+using namespace llvm;
+
+// the checking tools
+//
+//   each tool is a separate program (its main calls runTool), but the
+//   tools can also be run by the rchk driver, several on one parsed and
+//   linked module, sharing the module analyses (analyses.h)
+//
+//   a tool checks the functions of interest of module m, writes its results
+//   to outs() and errs() and returns the exit status; the options specific
+//   to the tool are removed from the arguments by parseOptions (may be NULL)
+//   before the arguments are parsed by parseArgsReadIR
+
+struct ToolTy {
+  const char* name;
+  void (*parseOptions)(int& argc, char* argv[]);
+  int (*run)(Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context);
+};
+
+extern const ToolTy alloccheckTool;
+extern const ToolTy bcheckTool;
+extern const ToolTy cgcheckTool;
+extern const ToolTy csfpcheckTool;
+extern const ToolTy errcheckTool;
+extern const ToolTy fficheckTool;
+extern const ToolTy glcheckTool;
+extern const ToolTy maacheckTool;
+extern const ToolTy sfpcheckTool;
+extern const ToolTy symcheckTool;
+extern const ToolTy ueacheckTool;
+extern const ToolTy veccheckTool;
+
+// runs the tool as a separate program
+int runTool(int argc, char* argv[], const ToolTy& tool);
+
+#endif
@@ -23,7 +23,9 @@
 #include <llvm/Support/raw_ostream.h>
 
 #include "allocators.h"
+#include "analyses.h"
 #include "cgclosure.h"
+#include "tools.h"
 
 using namespace llvm;
 
@@ -128,42 +130,6 @@ Instruction* getProtect(AllocaInst *v, const StoreInst *allocStore, const Instru
   return NULL;
 }
 
-// FIXME: copy-paste from maacheck vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
-
-enum ArgExpKind {
-  AK_NOALLOC = 0,  // no allocation
-  AK_ALLOCATING,   // allocation, but not returning a fresh object
-  AK_FRESH         // allocation and possibly returning a fresh object
-};
-
-ArgExpKind classifyArgumentExpression(Value *arg, FunctionsInfoMapTy& functionsMap, unsigned gcFunctionIndex, FunctionsSetTy& possibleAllocators) {
-
-  if (!CallInst::classof(arg)) {
-    // argument does not come (immediatelly) from a call
-    return AK_NOALLOC;
-  }
-
-  CallInst *cinst = cast<CallInst>(arg);
-  Function *fun = cinst->getCalledFunction();
-  if (!fun) {
-    return AK_NOALLOC;
-  }
-
-  if (!isAllocatingFunction(fun, functionsMap, gcFunctionIndex)) {
-    // argument does not come from a call to an allocating function
-    return AK_NOALLOC;
-  }
-
-  if (possibleAllocators.find(fun) != possibleAllocators.end()) {
-    // the argument allocates and returns a fresh object
-    return AK_FRESH;
-  }
-  return AK_ALLOCATING;
-}
-
-// FIXME: copy-paste from maacheck ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
-
-
 // this is approximative only
 bool isLoadOfUnprotectedObject(Value *arg, Instruction *callInst, FunctionsSetTy& possibleAllocators, DominatorTree& dominatorTree) {
   if (!LoadInst::classof(arg)) {
@@ -192,23 +158,14 @@ bool isLoadOfUnprotectedObject(Value *arg, Instruction *callInst, FunctionsSetTy
   return false;
 }
 
-int main(int argc, char* argv[])
-{
-  LLVMContext context;
-  FunctionsOrderedSetTy functionsOfInterestSet;
-  FunctionsVectorTy functionsOfInterestVector;
-  
-  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);  
+static int runUeacheck(Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
   
-  FunctionsInfoMapTy functionsMap;
-  buildCGClosure(m, functionsMap, true /* ignore error paths */);
+  ModuleAnalysesTy *analyses = getModuleAnalyses(m);
+  FunctionsInfoMapTy& functionsMap = *analyses->getFunctionsInfo();
   
-  unsigned gcFunctionIndex = getGCFunctionIndex(functionsMap, m);
-
-  FunctionsSetTy possibleAllocators;
-  findPossibleAllocators(m, possibleAllocators); // FIXME: use context-sensitive (more precise) allocator detection
+  const FunctionsBitsTy& gcCallers = analyses->getGCCallers();
 
-  DominatorTreeWrapperPass dtPass;
+  FunctionsSetTy& possibleAllocators = *analyses->getPossibleAllocators(); // FIXME: use context-sensitive (more precise) allocator detection
 
   for(FunctionsVectorTy::iterator FI = functionsOfInterestVector.begin(), FE = functionsOfInterestVector.end(); FI != FE; ++FI) {
 
@@ -220,8 +177,7 @@ int main(int argc, char* argv[])
       continue;
     }
 
-    dtPass.runOnFunction(*const_cast<Function*>(finfo.function));
-    DominatorTree& dominatorTree = dtPass.getDomTree();
+    DominatorTree& dominatorTree = *analyses->getDominatorTree(const_cast<Function*>(finfo.function));
     
     for(std::vector<CallInfo>::const_iterator CI = finfo.callInfos.begin(), CE = finfo.callInfos.end(); CI != CE; ++CI) {
       const CallInfo& cinfo = *CI;
@@ -250,7 +206,7 @@ int main(int argc, char* argv[])
           k = AK_NOALLOC;
           for(unsigned i = 0; i < nvals; i++) {
             Value* incoming = phi->getIncomingValue(i);
-            ArgExpKind cur = classifyArgumentExpression(incoming, functionsMap, gcFunctionIndex, possibleAllocators);
+            ArgExpKind cur = classifyArgumentExpression(incoming, functionsMap, gcCallers, possibleAllocators);
             if (isLoadOfUnprotectedObject(incoming, const_cast<Instruction*>(inst), possibleAllocators, dominatorTree)) {
               cur = AK_FRESH;
             }
@@ -260,7 +216,7 @@ int main(int argc, char* argv[])
             }
           }
         } else {
-          k = classifyArgumentExpression(o, functionsMap, gcFunctionIndex, possibleAllocators);
+          k = classifyArgumentExpression(o, functionsMap, gcCallers, possibleAllocators);
           if (isLoadOfUnprotectedObject(o, const_cast<Instruction*>(inst), possibleAllocators, dominatorTree)) {
             k = AK_FRESH;
           }
@@ -285,5 +241,14 @@ int main(int argc, char* argv[])
     }
   }
   
-  delete m;
+  return 0;
+}
+
+const ToolTy ueacheckTool = { "ueacheck", NULL, runUeacheck };
+
+#ifndef RCHK_DRIVER
+int main(int argc, char* argv[])
+{
+  return runTool(argc, argv, ueacheckTool);
 }
+#endif
@@ -13,21 +13,25 @@
 #include <llvm/Support/raw_ostream.h>
 
 #include "vectors.h"
+#include "tools.h"
 
 using namespace llvm;
 
-int main(int argc, char* argv[])
-{
-  LLVMContext context;
-  FunctionsOrderedSetTy functionsOfInterestSet;
-  FunctionsVectorTy functionsOfInterestVector;
-  
-  Module *m = parseArgsReadIR(argc, argv, functionsOfInterestSet, functionsOfInterestVector, context);
+static int runVeccheck(Module *m, FunctionsOrderedSetTy& functionsOfInterestSet, FunctionsVectorTy& functionsOfInterestVector, LLVMContext& context) {
   CalledModuleTy *cm = CalledModuleTy::create(m);
   
     // FIXME: this will not discover many call-sites (will not include many interesting contexts)
   printVectorReturningFunctions(cm);
 
   CalledModuleTy::release(cm);
-  delete m;
+  return 0;
+}
+
+const ToolTy veccheckTool = { "veccheck", NULL, runVeccheck };
+
+#ifndef RCHK_DRIVER
+int main(int argc, char* argv[])
+{
+  return runTool(argc, argv, veccheckTool);
 }
+#endif
@@ -216,6 +216,18 @@ struct VectorsFunctionState {
     myassert(fsearch != functions.end());
     return fsearch->second;
   }  
+  
+  // adds the function when not yet present (in a demand-driven module)
+  static VectorsFunctionState& getOrAdd(FunctionTableTy& functions, Function *f, FunctionListTy& workList) {
+    auto fsearch = functions.find(f);
+    if (fsearch != functions.end()) {
+      return fsearch->second;
+    }
+    auto finsert = functions.insert({f, VectorsFunctionState(f)});
+    VectorsFunctionState& fstate = finsert.first->second;
+    fstate.addToWorkList(workList);
+    return fstate;
+  }
 };
 
 struct VrfStateTy {
@@ -301,7 +313,7 @@ static bool callReturnsOnlyVector(CallSite& cs, VectorsFunctionState& fstate, Ve
   
   if (DEBUG) errs() << " [target " << funNameWithContext(tgt, targs) << "]";
 
-  VectorsFunctionState& tstate = VectorsFunctionState::get(functions, tgt);
+  VectorsFunctionState& tstate = VectorsFunctionState::getOrAdd(functions, tgt, functionsWorkList);
   unsigned tcontextIdx = tstate.contextIndex.indexOf(targs);
 
   if (tcontextIdx < tstate.returnsOnlyVector.size()) {
@@ -484,8 +496,9 @@ static void analyzeFunction(VectorsFunctionState& fstate, FunctionTableTy& funct
       if (Instruction *in = dyn_cast<Instruction>(u)) {
         if (BasicBlock *bb = dyn_cast<BasicBlock>(in->getParent())) {
           Function *pf = bb->getParent();
-          if (isSEXP(pf->getReturnType())) {
-            VectorsFunctionState& pstate = VectorsFunctionState::get(functions, pf);
+          auto psearch = functions.find(pf);
+          if (psearch != functions.end()) { // not present when not (yet) needed in a demand-driven module
+            VectorsFunctionState& pstate = psearch->second;
             pstate.addToWorkList(functionsWorkList);
             if (DEBUG) errs() << "Marking dirty affected caller function " << funName(pf) << "\n";
             // NOTE: in case of recursive functions, we may be re-adding fun
@@ -504,6 +517,10 @@ void findVectorReturningFunctions(CalledModuleTy *cm) {
   FunctionTableTy &functions = res->functions;
   FunctionListTy workList;   // functions to be re-analyzed
  
+  if (cm->isDemandDriven()) {
+    return; // functions are added when queried, see isVectorReturningFunction
+  }
+  
   // add some functions to the worklist, with default contexts  
   Module *m = cm->getModule();
   for(Module::iterator fi = m->begin(), fe = m->end(); fi != fe; ++fi) {
@@ -662,6 +679,7 @@ bool isVectorProducingCall(Value *inst, CalledModuleTy* cm, SEXPGuardsChecker* s
       }
     }
     
+    std::lock_guard<SharedStateLockTy> lock(sharedStateLock); // updates vrfState
     return isVectorReturningFunction(cs.getCalledFunction(), targs, cm);
   }
   
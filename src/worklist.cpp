@@ -0,0 +1,76 @@
+
+#include "worklist.h"
+
+#include <cstdlib>
+#include <string>
+
+#include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Analysis/CFG.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace llvm;
+
+static WorkListStrategyTy workListStrategy = WLS_DFS;
+
+void parseWorkListOptions(int& argc, char* argv[]) {
+
+  std::string value;
+  if (!extractOption(argc, argv, "--worklist", value)) {
+    return;
+  }
+  if (value == "dfs") {
+    workListStrategy = WLS_DFS;
+  } else if (value == "bfs") {
+    workListStrategy = WLS_BFS;
+  } else if (value == "rpo") {
+    workListStrategy = WLS_RPO;
+  } else if (value == "loops-last") {
+    workListStrategy = WLS_LOOPS_LAST;
+  } else {
+    errs() << "ERROR: invalid value " << value << " for option --worklist (use dfs, bfs, rpo or loops-last)\n";
+    exit(1);
+  }
+}
+
+WorkListStrategyTy getWorkListStrategy() {
+  return workListStrategy;
+}
+
+void BlockPrioritiesTy::compute(const Function* f, WorkListStrategyTy s) {
+
+  if (fun == f && strategy == s) {
+    return;
+  }
+  fun = f;
+  strategy = s;
+  priorities.clear();
+
+  unsigned n = 0;
+  ReversePostOrderTraversal<const Function*> rpot(f);
+  for(ReversePostOrderTraversal<const Function*>::rpo_iterator bi = rpot.begin(), be = rpot.end(); bi != be; ++bi) {
+    priorities.insert({*bi, n++});
+  }
+
+  if (s == WLS_LOOPS_LAST) {
+    // loop headers are the targets of back edges, they go after all other blocks
+    SmallVector<std::pair<const BasicBlock*, const BasicBlock*>, 32> backEdges;
+    FindFunctionBackedges(*f, backEdges);
+    for(SmallVector<std::pair<const BasicBlock*, const BasicBlock*>, 32>::iterator ei = backEdges.begin(), ee = backEdges.end(); ei != ee; ++ei) {
+      unsigned& p = priorities[ei->second];
+      if (p < n) {
+        p += n;
+      }
+    }
+  }
+}
+
+unsigned BlockPrioritiesTy::get(const BasicBlock* bb) const {
+
+  auto psearch = priorities.find(bb);
+  if (psearch == priorities.end()) {
+    return 2 * priorities.size(); // not reachable from the entry
+  }
+  return psearch->second;
+}
@@ -0,0 +1,131 @@
+#ifndef RCHK_WORKLIST_H
+#define RCHK_WORKLIST_H
+
+#include "common.h"
+
+#include <deque>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Function.h>
+
+using namespace llvm;
+
+// order in which states of a function are explored (in bcheck and in
+// computing called allocators)
+//
+//   selected by option --worklist STRATEGY given before the file names
+//
+//     dfs         last added state first (default)
+//     bfs         first added state first
+//     rpo         state of the earliest basic block in reverse post-order first
+//     loops-last  like rpo, but states of loop headers only when there are
+//                 no other states, so that more states of a loop body are
+//                 merged before the next iteration of the loop is explored
+//
+//   the set of explored states does not depend on the strategy, but the
+//   number of states traversed does when the exploration is aborted (e.g.
+//   on a restart in bcheck or when the state budget is exceeded)
+
+enum WorkListStrategyTy {
+  WLS_DFS = 0,
+  WLS_BFS,
+  WLS_RPO,
+  WLS_LOOPS_LAST
+};
+
+// removes the worklist option from the arguments
+void parseWorkListOptions(int& argc, char* argv[]);
+
+WorkListStrategyTy getWorkListStrategy();
+
+// priorities of basic blocks of a function for a strategy, lower is explored first
+class BlockPrioritiesTy {
+
+  const Function* fun;
+  WorkListStrategyTy strategy;
+  std::unordered_map<const BasicBlock*, unsigned> priorities;
+
+  public:
+    BlockPrioritiesTy(): fun(NULL), strategy(WLS_DFS), priorities() {};
+
+    void compute(const Function* f, WorkListStrategyTy s); // no-op when already computed
+    unsigned get(const BasicBlock* bb) const;
+    void clear() { fun = NULL; priorities.clear(); }
+};
+
+// worklist of states, StatePtr is a pointer to a state with field bb
+
+template <class StatePtr> class StateWorkList {
+
+  struct Entry {
+    unsigned priority;
+    unsigned long seq; // ties are explored in the order of adding
+    StatePtr state;
+
+    bool operator<(const Entry& other) const { // std::priority_queue takes the largest first
+      return priority > other.priority || (priority == other.priority && seq > other.seq);
+    }
+  };
+
+  WorkListStrategyTy strategy;
+  std::vector<StatePtr> stack;
+  std::deque<StatePtr> queue;
+  std::priority_queue<Entry> heap;
+  unsigned long nextSeq;
+  BlockPrioritiesTy priorities;
+
+  public:
+    StateWorkList(): strategy(getWorkListStrategy()), stack(), queue(), heap(), nextSeq(0), priorities() {};
+
+    // must be called before adding states of a function
+    void setFunction(const Function* fun) {
+      strategy = getWorkListStrategy();
+      if (strategy == WLS_RPO || strategy == WLS_LOOPS_LAST) {
+        priorities.compute(fun, strategy);
+      }
+    }
+
+    void push(StatePtr s) {
+      switch(strategy) {
+        case WLS_DFS: stack.push_back(s); break;
+        case WLS_BFS: queue.push_back(s); break;
+        default: heap.push({priorities.get(s->bb), nextSeq++, s}); break;
+      }
+    }
+
+    StatePtr top() const {
+      switch(strategy) {
+        case WLS_DFS: return stack.back();
+        case WLS_BFS: return queue.front();
+        default: return heap.top().state;
+      }
+    }
+
+    void pop() {
+      switch(strategy) {
+        case WLS_DFS: stack.pop_back(); break;
+        case WLS_BFS: queue.pop_front(); break;
+        default: heap.pop(); break;
+      }
+    }
+
+    bool empty() const {
+      return stack.empty() && queue.empty() && heap.empty();
+    }
+
+    size_t size() const {
+      return stack.size() + queue.size() + heap.size();
+    }
+
+    void clear() {
+      std::vector<StatePtr>().swap(stack);
+      std::deque<StatePtr>().swap(queue);
+      std::priority_queue<Entry>().swap(heap);
+      nextSeq = 0;
+    }
+};
+
+#endif